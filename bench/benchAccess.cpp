@@ -0,0 +1,86 @@
+// Element access in tight loops: indexed read-modify-write (stores through
+// int* may alias the vector's own size and pointer fields) and range-for.
+// Names are access/op/int/N=16/container/<size>; size N is inline, 8N is on
+// the heap. `make asm` writes the code of the kernels to benchAccess.s.
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "../src/compactVector.hpp"
+#include "../src/smallVector.hpp"
+#include "benchCommon.hpp"
+
+namespace bench {
+
+// Out of line so each one can be read in the assembly
+template <typename V>
+__attribute__((noinline)) void scaleIndexed(V &v, int k) {
+  for (size_t i = 0; i < v.size(); i++) v[i] *= k;
+}
+
+template <typename V>
+__attribute__((noinline)) int sumRange(const V &v) {
+  int res = 0;
+  for (int x : v) res += x;
+  return res;
+}
+
+template void scaleIndexed(mpc::smallVector<int, 16> &, int);
+template void scaleIndexed(mpc::compactVector<int, 16> &, int);
+template void scaleIndexed(std::vector<int> &, int);
+template int sumRange(const mpc::smallVector<int, 16> &);
+template int sumRange(const mpc::compactVector<int, 16> &);
+template int sumRange(const std::vector<int> &);
+
+}  // namespace bench
+
+namespace {
+
+template <typename V>
+V makeVec(benchmark::State &state) {
+  V v;
+  for (int64_t i = 0; i < state.range(0); i++) v.push_back(int(i));
+  return v;
+}
+
+template <typename V>
+void scaleIndexed(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    bench::scaleIndexed(v, 3);
+    benchmark::DoNotOptimize(v.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename V>
+void sumRange(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(bench::sumRange(v));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+template <typename V>
+void registerAccess(const std::string &name) {
+  const std::string prefix = "access/";
+  const std::string suffix = "/int/N=16/" + name;
+  benchmark::RegisterBenchmark((prefix + "scaleIndexed" + suffix).c_str(),
+                               scaleIndexed<V>)
+      ->Arg(16)
+      ->Arg(128);
+  benchmark::RegisterBenchmark((prefix + "sumRange" + suffix).c_str(),
+                               sumRange<V>)
+      ->Arg(16)
+      ->Arg(128);
+}
+
+const bool registered =
+    (registerAccess<mpc::smallVector<int, 16>>("mpc"),
+     registerAccess<mpc::compactVector<int, 16>>("mpcCompact"),
+     registerAccess<std::vector<int>>("std"), true);
+
+}  // namespace
@@ -0,0 +1,93 @@
+#ifndef MPC_BENCH_COMMON
+#define MPC_BENCH_COMMON
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace bench {
+
+// Global operator new calls so far, counted in benchMain.cpp
+size_t allocCount() noexcept;
+
+// Reports operator new calls per iteration of a benchmark loop
+class allocCounter {
+  size_t m_start;
+
+ public:
+  allocCounter() : m_start(allocCount()) {}
+
+  void report(benchmark::State &state) const {
+    state.counters["allocs/op"] =
+        benchmark::Counter(static_cast<double>(allocCount() - m_start),
+                           benchmark::Counter::kAvgIterations);
+  }
+};
+
+//====================Element types====================
+
+// 64 byte trivially copyable payload
+struct pod64 {
+  uint64_t v[8];
+};
+
+// Copyable and movable only through user code, the move may throw so
+// containers have to copy on growth
+struct heavyMove {
+  int v;
+  heavyMove() : v(0) {}
+  explicit heavyMove(int i) : v(i) {}
+  heavyMove(const heavyMove &other) : v(other.v) {
+    benchmark::ClobberMemory();
+  }
+  heavyMove(heavyMove &&other) : v(other.v) {
+    other.v = -1;
+    benchmark::ClobberMemory();
+  }
+  heavyMove &operator=(const heavyMove &other) {
+    v = other.v;
+    return *this;
+  }
+  heavyMove &operator=(heavyMove &&other) {
+    v = other.v;
+    other.v = -1;
+    return *this;
+  }
+};
+
+template <typename T>
+T makeValue(int i);
+
+template <>
+inline int makeValue<int>(int i) {
+  return i;
+}
+
+template <>
+inline pod64 makeValue<pod64>(int i) {
+  pod64 p = {{uint64_t(i)}};
+  return p;
+}
+
+// Short enough for SSO, so only the container allocates
+template <>
+inline std::string makeValue<std::string>(int i) {
+  return std::to_string(i);
+}
+
+template <>
+inline heavyMove makeValue<heavyMove>(int i) {
+  return heavyMove(i);
+}
+
+// Something to sum while iterating
+inline int64_t weight(int v) { return v; }
+inline int64_t weight(const pod64 &v) { return int64_t(v.v[0]); }
+inline int64_t weight(const std::string &v) { return int64_t(v.size()); }
+inline int64_t weight(const heavyMove &v) { return v.v; }
+
+}  // namespace bench
+
+#endif  // MPC_BENCH_COMMON
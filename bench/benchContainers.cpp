@@ -0,0 +1,185 @@
+// smallVector against std::vector, absl::InlinedVector and
+// boost::container::small_vector. Names are op/type/N=<N>/container/<size>.
+
+#include <absl/container/inlined_vector.h>
+
+#include <boost/container/small_vector.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../src/allocators.hpp"
+#include "../src/compactVector.hpp"
+#include "../src/sharedSmallVector.hpp"
+#include "../src/smallVector.hpp"
+#include "benchCommon.hpp"
+
+namespace {
+
+template <typename V>
+void fill(V &v, int count) {
+  for (int i = 0; i < count; i++)
+    v.push_back(bench::makeValue<typename V::value_type>(i));
+}
+
+template <typename V>
+void finish(benchmark::State &state, const bench::allocCounter &allocs,
+            int64_t items) {
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * items);
+  state.counters["bytes"] = sizeof(V);
+}
+
+template <typename V>
+void pushBack(benchmark::State &state) {
+  const int count = static_cast<int>(state.range(0));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    V v;
+    fill(v, count);
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state, allocs, count);
+}
+
+template <typename V>
+void emplaceBack(benchmark::State &state) {
+  const int count = static_cast<int>(state.range(0));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    V v;
+    for (int i = 0; i < count; i++)
+      v.emplace_back(bench::makeValue<typename V::value_type>(i));
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state, allocs, count);
+}
+
+template <typename V>
+void copy(benchmark::State &state) {
+  V src;
+  fill(src, static_cast<int>(state.range(0)));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    // const, a non-const data() would detach a shared copy
+    const V v(src);
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state, allocs, 1);
+}
+
+// Move there and back again, so every iteration starts from the same state
+template <typename V>
+void move(benchmark::State &state) {
+  V a;
+  fill(a, static_cast<int>(state.range(0)));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    V b(std::move(a));
+    benchmark::DoNotOptimize(b.data());
+    a = std::move(b);
+  }
+  finish<V>(state, allocs, 1);
+}
+
+template <typename V>
+void swap(benchmark::State &state) {
+  V a, b;
+  fill(a, static_cast<int>(state.range(0)));
+  fill(b, static_cast<int>(state.range(0)) / 2);
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    a.swap(b);
+    benchmark::DoNotOptimize(a.data());
+    benchmark::DoNotOptimize(b.data());
+  }
+  finish<V>(state, allocs, 1);
+}
+
+template <typename V>
+void iterate(benchmark::State &state) {
+  V v;
+  fill(v, static_cast<int>(state.range(0)));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (const auto &e : v) sum += bench::weight(e);
+    benchmark::DoNotOptimize(sum);
+  }
+  finish<V>(state, allocs, state.range(0));
+}
+
+template <typename V>
+void reserve(benchmark::State &state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    V v;
+    v.reserve(count);
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state, allocs, 1);
+}
+
+template <typename V>
+void resize(benchmark::State &state) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    V v;
+    v.resize(count);
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state, allocs, state.range(0));
+}
+
+template <typename V>
+void registerOps(const std::string &suffix, int64_t n) {
+  // Inline, full inline buffer, first spill and well past it
+  const std::vector<int64_t> growing = {n > 1 ? n / 2 : 1, n, n + 1, n * 8};
+  const std::vector<int64_t> filled = {n, n * 8};
+  auto reg = [&](const char *op, void (*fn)(benchmark::State &),
+                 const std::vector<int64_t> &sizes) {
+    benchmark::internal::Benchmark *b =
+        benchmark::RegisterBenchmark((op + suffix).c_str(), fn);
+    for (int64_t s : sizes) b->Arg(s);
+  };
+  reg("pushBack", pushBack<V>, growing);
+  reg("emplaceBack", emplaceBack<V>, growing);
+  reg("copy", copy<V>, filled);
+  reg("move", move<V>, filled);
+  reg("swap", swap<V>, filled);
+  reg("iterate", iterate<V>, filled);
+  reg("reserve", reserve<V>, growing);
+  reg("resize", resize<V>, growing);
+}
+
+template <typename T, size_t N>
+void registerType(const char *typeName) {
+  std::string suffix =
+      std::string("/") + typeName + "/N=" + std::to_string(N) + "/";
+  registerOps<mpc::smallVector<T, N>>(suffix + "mpc", N);
+  registerOps<mpc::compactVector<T, N>>(suffix + "mpcCompact", N);
+  registerOps<mpc::sharedSmallVector<T, N>>(suffix + "mpcShared", N);
+  registerOps<std::vector<T>>(suffix + "std", N);
+  registerOps<absl::InlinedVector<T, N>>(suffix + "absl", N);
+  registerOps<boost::container::small_vector<T, N>>(suffix + "boost", N);
+  // Spill and destroy through the per-thread block cache
+  benchmark::RegisterBenchmark(("pushBack" + suffix + "mpcCached").c_str(),
+                               pushBack<mpc::cachedSmallVector<T, N>>)
+      ->Arg(N + 1)
+      ->Arg(N * 8);
+}
+
+template <size_t N>
+void registerAll() {
+  registerType<int, N>("int");
+  registerType<bench::pod64, N>("pod64");
+  registerType<std::string, N>("string");
+  registerType<bench::heavyMove, N>("heavyMove");
+}
+
+const bool registered = (registerAll<4>(), registerAll<16>(),
+                         registerAll<64>(), true);
+
+}  // namespace
@@ -0,0 +1,26 @@
+// Benchmark driver, every bench/*.cpp registers its own benchmarks.
+// Global operator new is replaced to count allocations.
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "benchCommon.hpp"
+
+static std::atomic<size_t> g_allocs(0);
+
+size_t bench::allocCount() noexcept {
+  return g_allocs.load(std::memory_order_relaxed);
+}
+
+void *operator new(size_t size) {
+  g_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+// mpc::parallel algorithms on a spilled smallVector<uint32_t, 16> of 2^22
+// elements, against the serial std algorithm. Names are
+// parallel/op/threads:<T>, threads counts the caller, so a pool of T - 1
+// workers. Past the core count the extra threads only add contention.
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+
+#include "../src/parallel.hpp"
+#include "../src/smallVector.hpp"
+#include "benchCommon.hpp"
+
+namespace {
+
+typedef mpc::smallVector<uint32_t, 16> vec;
+
+const size_t elems = size_t(1) << 22;
+
+vec makeVec() {
+  vec v;
+  v.resize_for_overwrite(elems);
+  uint32_t x = 12345;
+  for (uint32_t &e : v) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    e = x;
+  }
+  return v;
+}
+
+void finish(benchmark::State &state) {
+  state.SetItemsProcessed(state.iterations() * elems);
+}
+
+// The copy is part of every iteration, run the std variant to subtract it
+void sortParallel(benchmark::State &state) {
+  mpc::parallel::threadPool pool(state.range(0) - 1);
+  const vec src = makeVec();
+  for (auto _ : state) {
+    vec v(src);
+    mpc::parallel::sort(v, std::less<uint32_t>(), pool);
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish(state);
+}
+
+void sortStd(benchmark::State &state) {
+  const vec src = makeVec();
+  for (auto _ : state) {
+    vec v(src);
+    std::sort(v.begin(), v.end());
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish(state);
+}
+
+void reduceParallel(benchmark::State &state) {
+  mpc::parallel::threadPool pool(state.range(0) - 1);
+  const vec v = makeVec();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(
+        mpc::parallel::reduce(v, uint64_t(0), std::plus<uint64_t>(), pool));
+  finish(state);
+}
+
+void reduceStd(benchmark::State &state) {
+  const vec v = makeVec();
+  for (auto _ : state)
+    benchmark::DoNotOptimize(std::accumulate(v.begin(), v.end(), uint64_t(0)));
+  finish(state);
+}
+
+void forEachParallel(benchmark::State &state) {
+  mpc::parallel::threadPool pool(state.range(0) - 1);
+  vec v = makeVec();
+  for (auto _ : state) {
+    mpc::parallel::for_each(v, [](uint32_t &e) { e = e * 2654435761u; },
+                            pool);
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish(state);
+}
+
+void forEachStd(benchmark::State &state) {
+  vec v = makeVec();
+  for (auto _ : state) {
+    std::for_each(v.begin(), v.end(), [](uint32_t &e) { e = e * 2654435761u; });
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish(state);
+}
+
+void transformParallel(benchmark::State &state) {
+  mpc::parallel::threadPool pool(state.range(0) - 1);
+  const vec v = makeVec();
+  mpc::smallVector<uint64_t, 0> out;
+  for (auto _ : state) {
+    mpc::parallel::transform(v, out, [](uint32_t e) { return uint64_t(e) * e; },
+                             pool);
+    benchmark::DoNotOptimize(out.data());
+  }
+  finish(state);
+}
+
+void registerScaling(const char *name, void (*fn)(benchmark::State &)) {
+  benchmark::internal::Benchmark *b = benchmark::RegisterBenchmark(name, fn);
+  b->ArgName("threads")->UseRealTime()->Unit(benchmark::kMillisecond);
+  for (int t = 1; t <= 64; t *= 2) b->Arg(t);
+}
+
+const bool registered =
+    (registerScaling("parallel/sort", sortParallel),
+     registerScaling("parallel/reduce", reduceParallel),
+     registerScaling("parallel/forEach", forEachParallel),
+     registerScaling("parallel/transform", transformParallel),
+     benchmark::RegisterBenchmark("parallel/sort/std", sortStd)
+         ->Unit(benchmark::kMillisecond),
+     benchmark::RegisterBenchmark("parallel/reduce/std", reduceStd)
+         ->Unit(benchmark::kMillisecond),
+     benchmark::RegisterBenchmark("parallel/forEach/std", forEachStd)
+         ->Unit(benchmark::kMillisecond),
+     true);
+
+}  // namespace
@@ -0,0 +1,58 @@
+// FIFO workloads: a queue of steady length <size> takes one push_back and
+// one pop_front per item. smallVector pops with erase(begin()), O(size).
+// Names are queue/fifo/int/N=16/container/<size>.
+
+#include <deque>
+#include <string>
+
+#include "../src/smallDeque.hpp"
+#include "../src/smallVector.hpp"
+#include "benchCommon.hpp"
+
+namespace {
+
+template <typename Q>
+void popFront(Q &q) {
+  q.pop_front();
+}
+
+template <typename T, size_t N>
+void popFront(mpc::smallVector<T, N> &q) {
+  q.erase(q.begin());
+}
+
+template <typename Q>
+void fifo(benchmark::State &state) {
+  const int len = static_cast<int>(state.range(0));
+  const int items = 1024;
+  bench::allocCounter allocs;
+  for (auto _ : state) {
+    Q q;
+    for (int i = 0; i < len; i++) q.push_back(i);
+    int sum = 0;
+    for (int i = 0; i < items; i++) {
+      q.push_back(i);
+      sum += q.front();
+      popFront(q);
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations() * items);
+}
+
+template <typename Q>
+void registerQueue(const std::string &name) {
+  benchmark::RegisterBenchmark(("queue/fifo/int/N=16/" + name).c_str(),
+                               fifo<Q>)
+      ->Arg(8)
+      ->Arg(15)
+      ->Arg(128);
+}
+
+const bool registered =
+    (registerQueue<mpc::smallDeque<int, 16>>("mpcDeque"),
+     registerQueue<mpc::smallVector<int, 16>>("mpc"),
+     registerQueue<std::deque<int>>("std"), true);
+
+}  // namespace
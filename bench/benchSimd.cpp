@@ -0,0 +1,190 @@
+// mpc::simd kernels against the std algorithms on smallVector<float, N> and
+// smallVector<uint32_t, 32>. Names are simd/op/type/N=<N>/impl/<size>, the
+// kernel set in use is in the label.
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../src/simd.hpp"
+#include "../src/smallVector.hpp"
+#include "benchCommon.hpp"
+
+namespace {
+
+template <typename V>
+V makeVec(benchmark::State &state) {
+  V v;
+  for (int64_t i = 0; i < state.range(0); i++)
+    v.push_back(static_cast<typename V::value_type>(i % 97));
+  return v;
+}
+
+template <typename V>
+void finish(benchmark::State &state) {
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel(mpc::simd::isaName());
+}
+
+template <typename V>
+void sumMpc(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(mpc::simd::sum(v));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void sumStd(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(
+        std::accumulate(v.begin(), v.end(), typename V::value_type()));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void minMpc(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(mpc::simd::min(v));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void minStd(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(*std::min_element(v.begin(), v.end()));
+  }
+  finish<V>(state);
+}
+
+// The value is absent, so the whole range is scanned
+template <typename V>
+void findMpc(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(
+        mpc::simd::find(v, typename V::value_type(1000)));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void findStd(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(
+        std::find(v.begin(), v.end(), typename V::value_type(1000)));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void countMpc(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(mpc::simd::count(v, typename V::value_type(3)));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void countStd(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(v.data());
+    benchmark::DoNotOptimize(
+        std::count(v.begin(), v.end(), typename V::value_type(3)));
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void addMpc(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  V w = makeVec<V>(state);
+  for (auto _ : state) {
+    mpc::simd::add(v, w.data());
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void addStd(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  V w = makeVec<V>(state);
+  for (auto _ : state) {
+    std::transform(v.begin(), v.end(), w.begin(), v.begin(),
+                   std::plus<typename V::value_type>());
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void fillMpc(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    mpc::simd::fill(v, typename V::value_type(7));
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state);
+}
+
+template <typename V>
+void fillStd(benchmark::State &state) {
+  V v = makeVec<V>(state);
+  for (auto _ : state) {
+    std::fill(v.begin(), v.end(), typename V::value_type(7));
+    benchmark::DoNotOptimize(v.data());
+  }
+  finish<V>(state);
+}
+
+template <typename T, size_t N>
+void registerType(const char *typeName) {
+  typedef mpc::smallVector<T, N> V;
+  // Inline and full, inline and partly filled, on the heap
+  const std::vector<int64_t> sizes = {int64_t(N) - 3, int64_t(N), 1024};
+  std::string prefix = std::string("/") + typeName + "/N=" + std::to_string(N);
+  auto reg = [&](const char *op, void (*mpcFn)(benchmark::State &),
+                 void (*stdFn)(benchmark::State &)) {
+    std::string name = std::string("simd/") + op + prefix;
+    benchmark::RegisterBenchmark((name + "/mpc").c_str(), mpcFn)
+        ->Args({sizes[0]})
+        ->Args({sizes[1]})
+        ->Args({sizes[2]});
+    benchmark::RegisterBenchmark((name + "/std").c_str(), stdFn)
+        ->Args({sizes[0]})
+        ->Args({sizes[1]})
+        ->Args({sizes[2]});
+  };
+  reg("sum", sumMpc<V>, sumStd<V>);
+  reg("min", minMpc<V>, minStd<V>);
+  reg("find", findMpc<V>, findStd<V>);
+  reg("count", countMpc<V>, countStd<V>);
+  reg("add", addMpc<V>, addStd<V>);
+  reg("fill", fillMpc<V>, fillStd<V>);
+}
+
+// N=8 floats take the unrolled inline loops
+const bool registered = (registerType<float, 8>("float"),
+                         registerType<float, 16>("float"),
+                         registerType<uint32_t, 32>("uint32"), true);
+
+}  // namespace
@@ -0,0 +1,76 @@
+// Key building: "<prefix>:<id>:<suffix>" of 20 to 40 characters, appended
+// piece by piece and hashed. std::string spills past 15 characters.
+// Names are string/<op>/<container>/<suffix length>.
+
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "../src/smallString.hpp"
+#include "benchCommon.hpp"
+
+namespace {
+
+const char *const prefix = "session";
+
+template <typename S>
+void appendId(S &s, int64_t id) {
+  s += std::to_string(id);
+}
+
+template <>
+void appendId(mpc::smallString<48> &s, int64_t id) {
+  s.append_int(id);
+}
+
+template <typename S>
+void buildKey(benchmark::State &state) {
+  const std::string suffix(static_cast<size_t>(state.range(0)), 'x');
+  bench::allocCounter allocs;
+  int64_t id = 1234567;
+  for (auto _ : state) {
+    S key;
+    key += prefix;
+    key += ':';
+    appendId(key, id++);
+    key += ':';
+    key += suffix;
+    benchmark::DoNotOptimize(key.data());
+  }
+  allocs.report(state);
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename S>
+size_t hashOf(const S &s) {
+  return std::hash<std::string_view>()(std::string_view(s.data(), s.size()));
+}
+
+size_t hashOf(const mpc::smallString<48> &s) { return s.hash(); }
+
+template <typename S>
+void hashKey(benchmark::State &state) {
+  S key(prefix);
+  key += std::string(static_cast<size_t>(state.range(0)), 'x');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(key.data());
+    benchmark::DoNotOptimize(hashOf(key));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+template <typename S>
+void registerString(const std::string &name) {
+  benchmark::RegisterBenchmark(("string/buildKey/" + name).c_str(),
+                               buildKey<S>)
+      ->Arg(4)
+      ->Arg(24);
+  benchmark::RegisterBenchmark(("string/hashKey/" + name).c_str(), hashKey<S>)
+      ->Arg(4)
+      ->Arg(24);
+}
+
+const bool registered = (registerString<mpc::smallString<48>>("mpc"),
+                         registerString<std::string>("std"), true);
+
+}  // namespace
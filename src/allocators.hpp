@@ -0,0 +1,569 @@
+#ifndef MPC_ALLOCATORS
+#define MPC_ALLOCATORS
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__) || defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+#include "smallVector.hpp"
+
+namespace mpc {
+
+//====================Memory resources====================
+
+// std::pmr::memory_resource look-alike usable from C++11
+class memoryResource {
+ public:
+  virtual ~memoryResource() {}
+
+  void *allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+    return doAllocate(bytes, align);
+  }
+
+  void deallocate(void *p, size_t bytes,
+                  size_t align = alignof(std::max_align_t)) {
+    doDeallocate(p, bytes, align);
+  }
+
+  bool is_equal(const memoryResource &other) const noexcept {
+    return doIsEqual(other);
+  }
+
+ private:
+  virtual void *doAllocate(size_t bytes, size_t align) = 0;
+  virtual void doDeallocate(void *p, size_t bytes, size_t align) = 0;
+  virtual bool doIsEqual(const memoryResource &other) const noexcept = 0;
+};
+
+inline bool operator==(const memoryResource &a,
+                       const memoryResource &b) noexcept {
+  return &a == &b || a.is_equal(b);
+}
+
+inline bool operator!=(const memoryResource &a,
+                       const memoryResource &b) noexcept {
+  return !(a == b);
+}
+
+namespace detail {
+
+class newDeleteImpl : public memoryResource {
+  void *doAllocate(size_t bytes, size_t align) override {
+    assert(align <= alignof(std::max_align_t));
+    (void)align;
+    return ::operator new(bytes);
+  }
+
+  void doDeallocate(void *p, size_t, size_t) override { ::operator delete(p); }
+
+  bool doIsEqual(const memoryResource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+}  // namespace detail
+
+// Global ::operator new / ::operator delete
+inline memoryResource *newDeleteResource() noexcept {
+  static detail::newDeleteImpl res;
+  return &res;
+}
+
+// Bump allocator over chunks taken from upstream. deallocate() gives nothing
+// back; release() (or the destructor) frees every chunk at once, so all
+// vectors spilled into the arena are gone in one go.
+class arenaResource : public memoryResource {
+ public:
+  explicit arenaResource(size_t chunkSize = 4096,
+                         memoryResource *upstream = newDeleteResource())
+      : m_cur(nullptr),
+        m_end(nullptr),
+        m_initBuff(nullptr),
+        m_initSize(0),
+        m_chunks(nullptr),
+        m_initChunkSize(chunkSize ? chunkSize : 1),
+        m_chunkSize(m_initChunkSize),
+        m_upstream(upstream) {}
+
+  // Serves from buffer (e.g. on the stack) first, then from upstream
+  arenaResource(void *buffer, size_t bufferSize,
+                memoryResource *upstream = newDeleteResource())
+      : arenaResource(bufferSize ? bufferSize : 1, upstream) {
+    m_initBuff = static_cast<char *>(buffer);
+    m_initSize = bufferSize;
+    m_cur = m_initBuff;
+    m_end = m_initBuff + bufferSize;
+  }
+
+  arenaResource(const arenaResource &) = delete;
+  arenaResource &operator=(const arenaResource &) = delete;
+
+  ~arenaResource() { release(); }
+
+  // Inlined fast path, used directly by arenaAllocator
+  void *bump(size_t bytes, size_t align) {
+    size_t pad = static_cast<size_t>(-reinterpret_cast<uintptr_t>(m_cur)) &
+                 (align - 1);
+    if (m_cur && pad + bytes <= static_cast<size_t>(m_end - m_cur)) {
+      char *res = m_cur + pad;
+      m_cur = res + bytes;
+      return res;
+    }
+    return bumpSlow(bytes, align);
+  }
+
+  // Frees all chunks, the initial buffer is reused
+  void release() noexcept {
+    while (m_chunks) {
+      chunk *next = m_chunks->next;
+      m_upstream->deallocate(m_chunks, m_chunks->size);
+      m_chunks = next;
+    }
+    m_cur = m_initBuff;
+    m_end = m_initBuff + m_initSize;
+    m_chunkSize = m_initChunkSize;
+  }
+
+  memoryResource *upstream() const noexcept { return m_upstream; }
+
+ private:
+  struct chunk {
+    chunk *next;
+    size_t size;
+  };
+
+  char *m_cur;
+  char *m_end;
+  char *m_initBuff;
+  size_t m_initSize;
+  chunk *m_chunks;
+  size_t m_initChunkSize;
+  size_t m_chunkSize;
+  memoryResource *m_upstream;
+
+  // Next chunk, chunk sizes grow geometrically
+  void *bumpSlow(size_t bytes, size_t align) {
+    size_t need = sizeof(chunk) + bytes + align;
+    size_t size = need > m_chunkSize ? need : m_chunkSize;
+    chunk *c = static_cast<chunk *>(m_upstream->allocate(size));
+    c->next = m_chunks;
+    c->size = size;
+    m_chunks = c;
+    m_chunkSize *= 2;
+    m_cur = reinterpret_cast<char *>(c + 1);
+    m_end = reinterpret_cast<char *>(c) + size;
+    return bump(bytes, align);
+  }
+
+  void *doAllocate(size_t bytes, size_t align) override {
+    return bump(bytes, align);
+  }
+
+  void doDeallocate(void *, size_t, size_t) override {}
+
+  bool doIsEqual(const memoryResource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+//====================Allocators====================
+
+// malloc/realloc/free. On glibc the malloc_usable_size slack is reported
+// through allocate_at_least, so smallVector counts it as capacity.
+// reallocate() lets smallVector grow heap blocks of trivially relocatable T
+// without a copy; glibc serves large blocks with mmap and grows them with
+// mremap.
+template <typename T>
+class mallocAllocator {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+                "malloc does not serve over-aligned types");
+
+ public:
+  typedef T value_type;
+  typedef std::true_type is_always_equal;
+
+  mallocAllocator() noexcept {}
+
+  template <typename U>
+  mallocAllocator(const mallocAllocator<U> &) noexcept {}
+
+  T *allocate(size_t n) {
+    void *p = std::malloc(n * sizeof(T));
+    if (!p) detail::throwBadAlloc();
+    return static_cast<T *>(p);
+  }
+
+  allocationResult<T *> allocate_at_least(size_t n) {
+    T *p = allocate(n);
+    allocationResult<T *> res = {p, n};
+#if defined(__GLIBC__)
+    res.count = malloc_usable_size(p) / sizeof(T);
+#endif
+    return res;
+  }
+
+  // p stays valid when this throws
+  allocationResult<T *> reallocate(T *p, size_t, size_t n) {
+    void *np = std::realloc(p, n * sizeof(T));
+    if (!np) detail::throwBadAlloc();
+    allocationResult<T *> res = {static_cast<T *>(np), n};
+#if defined(__GLIBC__)
+    res.count = malloc_usable_size(np) / sizeof(T);
+#endif
+    return res;
+  }
+
+  void deallocate(T *p, size_t) noexcept { std::free(p); }
+
+  template <typename U>
+  bool operator==(const mallocAllocator<U> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const mallocAllocator<U> &) const noexcept {
+    return false;
+  }
+};
+
+namespace detail {
+
+inline void *alignedMalloc(size_t bytes, size_t align) {
+  void *p = nullptr;
+#if defined(_MSC_VER)
+  p = _aligned_malloc(bytes, align);
+#else
+  if (posix_memalign(&p, align, bytes)) p = nullptr;
+#endif
+  if (!p) throwBadAlloc();
+  return p;
+}
+
+inline void alignedFree(void *p) noexcept {
+#if defined(_MSC_VER)
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+}  // namespace detail
+
+// Heap blocks aligned to Align (posix_memalign), e.g. for aligned SIMD
+// loads or over-aligned T before C++17. smallVector aligns its inline buffer
+// to Align as well.
+template <typename T, size_t Align>
+class alignedAllocator {
+  static_assert(Align && (Align & (Align - 1)) == 0,
+                "alignment must be a power of two");
+  static_assert(Align >= alignof(T), "alignment below alignof(T)");
+
+ public:
+  typedef T value_type;
+  typedef std::true_type is_always_equal;
+  static const size_t alignment =
+      Align < sizeof(void *) ? sizeof(void *) : Align;
+
+  template <typename U>
+  struct rebind {
+    typedef alignedAllocator<U, Align> other;
+  };
+
+  alignedAllocator() noexcept {}
+
+  template <typename U>
+  alignedAllocator(const alignedAllocator<U, Align> &) noexcept {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(detail::alignedMalloc(n * sizeof(T), alignment));
+  }
+
+  void deallocate(T *p, size_t) noexcept { detail::alignedFree(p); }
+
+  template <typename U>
+  bool operator==(const alignedAllocator<U, Align> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const alignedAllocator<U, Align> &) const noexcept {
+    return false;
+  }
+};
+
+namespace detail {
+
+// Per-thread freelists of malloc blocks, one list per power-of-two size.
+// Blocks above maxShift and frees past the byte limit go straight to malloc.
+class blockCache {
+ public:
+  static const size_t minShift = 4;
+  static const size_t maxShift = 16;
+  static const size_t defaultLimit = size_t(1) << 20;
+
+  blockCache() noexcept : m_bytes(0), m_limit(defaultLimit) {
+    for (size_t i = 0; i <= maxShift - minShift; i++) m_lists[i] = nullptr;
+  }
+
+  blockCache(const blockCache &) = delete;
+  blockCache &operator=(const blockCache &) = delete;
+
+  ~blockCache() {
+    trim(0);
+    destroyed() = true;
+  }
+
+  static blockCache &local() noexcept {
+    static thread_local blockCache cache;
+    return cache;
+  }
+
+  // Set once the calling thread's cache is gone. A vector destroyed later in
+  // thread exit (a static, or a thread_local built before the cache) must
+  // not touch it. Trivially destructible, so it outlives the cache.
+  static bool &destroyed() noexcept {
+    static thread_local bool flag = false;
+    return flag;
+  }
+
+  // The calling thread's cache, or plain malloc and free after it is gone
+  static void *allocateLocal(size_t shift) {
+    if (MPC_SV_UNLIKELY(destroyed())) {
+      void *p = std::malloc(size_t(1) << shift);
+      if (!p) throwBadAlloc();
+      return p;
+    }
+    return local().allocate(shift);
+  }
+
+  static void deallocateLocal(void *p, size_t shift) noexcept {
+    if (MPC_SV_UNLIKELY(destroyed())) return std::free(p);
+    local().deallocate(p, shift);
+  }
+
+  // Smallest block size class holding bytes
+  static size_t shiftOf(size_t bytes) noexcept {
+    return bytes <= (size_t(1) << minShift) ? minShift
+                                            : log2Floor(bytes - 1) + 1;
+  }
+
+  void *allocate(size_t shift) {
+    if (shift <= maxShift && m_lists[shift - minShift]) {
+      node *n = m_lists[shift - minShift];
+      m_lists[shift - minShift] = n->next;
+      m_bytes -= size_t(1) << shift;
+      return n;
+    }
+    void *p = std::malloc(size_t(1) << shift);
+    if (!p) throwBadAlloc();
+    return p;
+  }
+
+  void deallocate(void *p, size_t shift) noexcept {
+    size_t bytes = size_t(1) << shift;
+    if (shift > maxShift || m_bytes + bytes > m_limit) return std::free(p);
+    node *n = static_cast<node *>(p);
+    n->next = m_lists[shift - minShift];
+    m_lists[shift - minShift] = n;
+    m_bytes += bytes;
+  }
+
+  // Frees cached blocks, largest first, until at most keep bytes remain
+  void trim(size_t keep) noexcept {
+    for (size_t i = maxShift - minShift + 1; i-- > 0 && m_bytes > keep;) {
+      while (m_lists[i] && m_bytes > keep) {
+        node *n = m_lists[i];
+        m_lists[i] = n->next;
+        m_bytes -= size_t(1) << (i + minShift);
+        std::free(n);
+      }
+    }
+  }
+
+  size_t bytes() const noexcept { return m_bytes; }
+
+  void setLimit(size_t limit) noexcept {
+    m_limit = limit;
+    trim(limit);
+  }
+
+ private:
+  struct node {
+    node *next;
+  };
+
+  node *m_lists[maxShift - minShift + 1];
+  size_t m_bytes;
+  size_t m_limit;
+};
+
+}  // namespace detail
+
+// Frees the calling thread's cached blocks down to keep bytes
+inline void trimBlockCache(size_t keep = 0) noexcept {
+  if (!detail::blockCache::destroyed()) detail::blockCache::local().trim(keep);
+}
+
+// Bytes cached by the calling thread
+inline size_t blockCacheBytes() noexcept {
+  return detail::blockCache::destroyed() ? 0
+                                         : detail::blockCache::local().bytes();
+}
+
+// Per-thread cap on cached bytes, 1 MiB by default
+inline void setBlockCacheLimit(size_t bytes) noexcept {
+  if (!detail::blockCache::destroyed())
+    detail::blockCache::local().setLimit(bytes);
+}
+
+// malloc blocks rounded up to powers of two, freed blocks are kept in a
+// per-thread freelist for the next allocation of the same size. Meant for
+// short-lived vectors that spill: the spill and the destructor stop reaching
+// malloc. A block freed on another thread lands in that thread's cache.
+template <typename T>
+class cachingAllocator {
+  static_assert(alignof(T) <= alignof(std::max_align_t),
+                "malloc does not serve over-aligned types");
+
+ public:
+  typedef T value_type;
+  typedef std::true_type is_always_equal;
+
+  cachingAllocator() noexcept {}
+
+  template <typename U>
+  cachingAllocator(const cachingAllocator<U> &) noexcept {}
+
+  T *allocate(size_t n) { return allocate_at_least(n).ptr; }
+
+  // The rest of the size class is reported as capacity, so the block comes
+  // back to the list it was taken from
+  allocationResult<T *> allocate_at_least(size_t n) {
+    if (n > SIZE_MAX / sizeof(T)) detail::throwBadAlloc();
+    size_t shift = detail::blockCache::shiftOf(n * sizeof(T));
+    allocationResult<T *> res = {
+        static_cast<T *>(detail::blockCache::allocateLocal(shift)),
+        (size_t(1) << shift) / sizeof(T)};
+    return res;
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    detail::blockCache::deallocateLocal(
+        p, detail::blockCache::shiftOf(n * sizeof(T)));
+  }
+
+  template <typename U>
+  bool operator==(const cachingAllocator<U> &) const noexcept {
+    return true;
+  }
+
+  template <typename U>
+  bool operator!=(const cachingAllocator<U> &) const noexcept {
+    return false;
+  }
+};
+
+// Allocates straight from an arenaResource without virtual calls.
+// Bound to its arena: it is not propagated on assignment or swap.
+template <typename T>
+class arenaAllocator {
+  arenaResource *m_arena;
+
+  template <typename U>
+  friend class arenaAllocator;
+
+ public:
+  typedef T value_type;
+
+  arenaAllocator(arenaResource *arena) noexcept : m_arena(arena) {}
+
+  template <typename U>
+  arenaAllocator(const arenaAllocator<U> &other) noexcept
+      : m_arena(other.m_arena) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(m_arena->bump(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *, size_t) noexcept {}
+
+  arenaResource *arena() const noexcept { return m_arena; }
+
+  template <typename U>
+  bool operator==(const arenaAllocator<U> &other) const noexcept {
+    return m_arena == other.m_arena;
+  }
+
+  template <typename U>
+  bool operator!=(const arenaAllocator<U> &other) const noexcept {
+    return m_arena != other.m_arena;
+  }
+};
+
+// std::pmr::polymorphic_allocator look-alike: a copy constructed container
+// gets the default resource, and the resource is never propagated.
+template <typename T>
+class polymorphicAllocator {
+  memoryResource *m_resource;
+
+ public:
+  typedef T value_type;
+
+  polymorphicAllocator() noexcept : m_resource(newDeleteResource()) {}
+
+  polymorphicAllocator(memoryResource *resource) noexcept
+      : m_resource(resource) {}
+
+  template <typename U>
+  polymorphicAllocator(const polymorphicAllocator<U> &other) noexcept
+      : m_resource(other.resource()) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(m_resource->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    m_resource->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  polymorphicAllocator select_on_container_copy_construction() const {
+    return polymorphicAllocator();
+  }
+
+  memoryResource *resource() const noexcept { return m_resource; }
+
+  template <typename U>
+  bool operator==(const polymorphicAllocator<U> &other) const noexcept {
+    return *m_resource == *other.resource();
+  }
+
+  template <typename U>
+  bool operator!=(const polymorphicAllocator<U> &other) const noexcept {
+    return !(*this == other);
+  }
+};
+
+// Inline buffer and heap blocks aligned to Align
+template <typename T, size_t N, size_t Align>
+using alignedSmallVector = smallVector<T, N, alignedAllocator<T, Align>>;
+
+template <typename T, size_t N = 8>
+using cachedSmallVector = smallVector<T, N, cachingAllocator<T>>;
+
+template <typename T, size_t N = 8>
+using arenaSmallVector = smallVector<T, N, arenaAllocator<T>>;
+
+namespace pmr {
+template <typename T, size_t N = 8>
+using smallVector = mpc::smallVector<T, N, polymorphicAllocator<T>>;
+}  // namespace pmr
+
+}  // namespace mpc
+
+#endif  // MPC_ALLOCATORS
@@ -0,0 +1,620 @@
+#ifndef MPC_COMPACTVECTOR
+#define MPC_COMPACTVECTOR
+
+// smallVector with the smallest footprint: the object is the N inline slots
+// plus one tag word. Inline, the tag holds the size; spilled, it points to a
+// heap block whose header keeps size and capacity in front of the
+// elements. compactVector<T, 0> is a single word. Every access pays a branch
+// on the tag, so prefer smallVector where access speed matters more than
+// sizeof.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "smallVector.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+template <typename T, size_t N>
+struct compactBuffer {
+  alignas(alignof(T)) char m_buff[sizeof(T) * N];
+
+  T *buff() noexcept { return reinterpret_cast<T *>(m_buff); }
+  const T *buff() const noexcept { return reinterpret_cast<const T *>(m_buff); }
+};
+
+// No inline slots, takes no space as a base
+template <typename T>
+struct compactBuffer<T, 0> {
+  T *buff() noexcept { return nullptr; }
+  const T *buff() const noexcept { return nullptr; }
+};
+
+// Size and capacity of a spilled compactVector, the elements follow
+struct compactHeader {
+  uint32_t size;
+  uint32_t capacity;
+};
+
+// Allocation unit of the heap block, aligned for the header and T
+template <size_t Align>
+struct alignas(Align) compactUnit {
+  unsigned char bytes[Align];
+};
+
+}  // namespace detail
+
+template <typename T, size_t N = 8, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+class compactVector : private detail::allocHolder<Alloc>,
+                      private detail::compactBuffer<T, N> {
+  static_assert(N <= UINT32_MAX, "inline capacity must fit in 32 bits");
+  static_assert(std::is_same<typename Alloc::value_type, T>::value,
+                "Alloc::value_type must be T");
+
+  typedef detail::allocHolder<Alloc> allocBase;
+  typedef detail::compactBuffer<T, N> buffBase;
+  typedef std::allocator_traits<Alloc> allocTraits;
+  typedef detail::compactHeader header;
+
+  static const size_t unitAlign =
+      alignof(T) > alignof(header) ? alignof(T) : alignof(header);
+  typedef detail::compactUnit<unitAlign> unit;
+  typedef typename allocTraits::template rebind_alloc<unit> unitAlloc;
+  typedef std::allocator_traits<unitAlloc> unitTraits;
+
+  // Elements start at the first T aligned offset after the header
+  static const size_t elemOffset =
+      (sizeof(header) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+  using buffBase::buff;
+
+  // Member variables
+  // size << 1 | 1 while inline, else the address of the heap header
+  uintptr_t m_tag;
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+  typedef Alloc allocator_type;
+
+  //====================Ctors and Dtors====================
+
+  compactVector() : compactVector(Alloc()) {}
+
+  explicit compactVector(const Alloc &alloc) : allocBase(alloc), m_tag(1) {}
+
+  // sz value-initialized elements
+  compactVector(const size_t sz, const Alloc &alloc = Alloc())
+      : compactVector(alloc) {
+    resize(sz);
+  }
+
+  compactVector(const compactVector &other)
+      : compactVector(allocTraits::select_on_container_copy_construction(
+            other.getAllocator())) {
+    append(other.begin(), other.end());
+  }
+
+  // Range constructor
+  template <typename It, typename = detail::requireIter<It>>
+  compactVector(It first, It last, const Alloc &alloc = Alloc())
+      : compactVector(alloc) {
+    append(first, last);
+  }
+
+  // Steals the heap block, or moves the inline elements
+  compactVector(compactVector &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value)
+      : compactVector(other.getAllocator()) {
+    takeFrom(other);
+  }
+
+  compactVector(std::initializer_list<T> init, const Alloc &alloc = Alloc())
+      : compactVector(alloc) {
+    append(init.begin(), init.end());
+  }
+
+  ~compactVector() {
+    clear();
+    if (!isInline()) freeBlock(head());
+  }
+
+  //___________________________Operators_______________________________
+
+  // Copy op =
+  compactVector &operator=(const compactVector &other) {
+    if (this == &other) return *this;
+    copyAssignAlloc(
+        other, typename allocTraits::propagate_on_container_copy_assignment());
+    assign(other.begin(), other.end());
+    return *this;
+  }
+
+  // Move op =
+  compactVector &operator=(compactVector &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value &&
+      (allocTraits::propagate_on_container_move_assignment::value ||
+       detail::allocAlwaysEqual<Alloc>::value)) {
+    if (this == &other) return *this;
+    moveAssign(other,
+               std::integral_constant<
+                   bool, allocTraits::propagate_on_container_move_assignment::
+                                 value ||
+                             detail::allocAlwaysEqual<Alloc>::value>());
+    return *this;
+  }
+
+  compactVector &operator=(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+    return *this;
+  }
+
+  reference operator[](size_t ind) { return begin()[ind]; }
+
+  const_reference operator[](size_t ind) const { return begin()[ind]; }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  void push_back(const T &inp) { emplace_back(inp); }
+
+  void push_back(T &&inp) { emplace_back(std::move(inp)); }
+
+  // Emplace back, growth is kept out of line
+  template <typename... Ts>
+  void emplace_back(Ts &&...params) {
+    size_t size = this->size();
+    if (MPC_SV_UNLIKELY(size == capacity()))
+      return growAndEmplace(std::forward<Ts>(params)...);
+    new (begin() + size) T(std::forward<Ts>(params)...);
+    setSize(size + 1);
+  }
+
+  // Like push_back, but returns false instead of reporting an error when
+  // the vector cannot grow
+  bool try_push_back(const T &inp) { return try_emplace_back(inp); }
+
+  bool try_push_back(T &&inp) { return try_emplace_back(std::move(inp)); }
+
+  template <typename... Ts>
+  bool try_emplace_back(Ts &&...params) {
+    size_t size = this->size();
+    if (MPC_SV_UNLIKELY(size == capacity()))
+      return tryGrowAndEmplace(std::forward<Ts>(params)...);
+    new (begin() + size) T(std::forward<Ts>(params)...);
+    setSize(size + 1);
+    return true;
+  }
+
+  // Appends [first, last), reserving once for forward ranges.
+  // The range must not point into this vector.
+  template <typename It, typename = detail::requireIter<It>>
+  void append(It first, It last) {
+    appendRange(first, last,
+                typename std::iterator_traits<It>::iterator_category());
+  }
+
+  // Appends n copies of val
+  void append(size_t n, const T &val) {
+    // val may live in this vector, copy it before the growth moves it
+    T copy(val);
+    PbEbCheck(size() + n);
+    std::uninitialized_fill_n(end(), n, copy);
+    setSize(size() + n);
+  }
+
+  void append(std::initializer_list<T> init) {
+    append(init.begin(), init.end());
+  }
+
+  // Appends n uninitialized elements and returns the first one
+  T *append_uninitialized(size_t n) {
+    static_assert(std::is_trivially_default_constructible<T>::value &&
+                      std::is_trivially_destructible<T>::value,
+                  "append_uninitialized needs a trivial T");
+    PbEbCheck(size() + n);
+    T *res = end();
+    setSize(size() + n);
+    return res;
+  }
+
+  // Replaces the contents with [first, last)
+  template <typename It, typename = detail::requireIter<It>>
+  void assign(It first, It last) {
+    clear();
+    append(first, last);
+  }
+
+  void assign(size_t n, const T &val) {
+    clear();
+    append(n, val);
+  }
+
+  void assign(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+  }
+
+  // Inserts [first, last) before pos, returns iterator to the first
+  // inserted element
+  template <typename It, typename = detail::requireIter<It>>
+  iterator insert(const_iterator pos, It first, It last) {
+    size_t index = pos - begin();
+    size_t oldSize = size();
+    append(first, last);
+    std::rotate(begin() + index, begin() + oldSize, end());
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  // Inserts n copies of val before pos
+  iterator insert(const_iterator pos, size_t n, const T &val) {
+    size_t index = pos - begin();
+    size_t oldSize = size();
+    // val may live in this vector, copy it before anything moves
+    T copy(val);
+    append(n, copy);
+    std::rotate(begin() + index, begin() + oldSize, end());
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, const T &val) { return emplace(pos, val); }
+
+  iterator insert(const_iterator pos, T &&val) {
+    return emplace(pos, std::move(val));
+  }
+
+  // Constructs an element before pos
+  template <typename... Ts>
+  iterator emplace(const_iterator pos, Ts &&...params) {
+    size_t index = pos - begin();
+    // params may refer to elements, build the value before shifting
+    T temp(std::forward<Ts>(params)...);
+    emplace_back(std::move(temp));
+    std::rotate(begin() + index, end() - 1, end());
+    return begin() + index;
+  }
+
+  // Destroys the last element
+  void pop_back() noexcept {
+    assert(!empty());
+    (end() - 1)->~T();
+    setSize(size() - 1);
+  }
+
+  // Erases the element at pos, returns iterator to the one after it
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    iterator it = begin() + (first - begin());
+    truncate(std::move(it + (last - first), end(), it) - begin());
+    return it;
+  }
+
+  // O(1) erase that moves the last element into pos, order is not kept
+  iterator unordered_erase(const_iterator pos) {
+    iterator it = begin() + (pos - begin());
+    if (it != end() - 1) *it = std::move(back());
+    pop_back();
+    return it;
+  }
+
+  // Reserves at least inp in vec
+  // Strong exc. guar.
+  void reserve(size_t inp) {
+    if (inp <= capacity()) return;
+    if (inp > UINT32_MAX) detail::throwLengthError("compactVector::reserve");
+    moveToHeap(inp);
+  }
+
+  // Like reserve, but returns false instead of reporting an error
+  bool try_reserve(size_t inp) {
+    if (inp <= capacity()) return true;
+    if (inp > UINT32_MAX) return false;
+#if MPC_SV_EXCEPTIONS
+    try {
+      moveToHeap(inp);
+    } catch (std::bad_alloc &) {
+      return false;
+    }
+#else
+    moveToHeap(inp);
+#endif
+    return true;
+  }
+
+  // Drops unused capacity, moves back into the inline slots once the
+  // elements fit in N again. Strong exc. guar.
+  void shrink_to_fit() {
+    if (isInline() || size() == capacity()) return;
+    if (size() > N) return moveToHeap(size());
+    header *old = head();
+    detail::relocateRange(elems(old), elems(old) + old->size, buff());
+    m_tag = inlineTag(old->size);
+    freeBlock(old);
+  }
+
+  // New elements are value-initialized in place
+  void resize(size_t size) {
+    if (size <= this->size()) return truncate(size);
+    reserve(size);
+    for (size_t i = this->size(); i < size; i++) {
+      new (begin() + i) T();
+      setSize(i + 1);
+    }
+  }
+
+  // New elements are copies of val
+  void resize(size_t size, const T &val) {
+    if (size <= this->size()) return truncate(size);
+    T copy(val);
+    reserve(size);
+    for (size_t i = this->size(); i < size; i++) {
+      new (begin() + i) T(copy);
+      setSize(i + 1);
+    }
+  }
+
+  // New elements are default-initialized, i.e. left indeterminate for
+  // trivial T
+  void resize_for_overwrite(size_t size) {
+    if (size <= this->size()) return truncate(size);
+    reserve(size);
+    for (size_t i = this->size(); i < size; i++) {
+      new (begin() + i) T;
+      setSize(i + 1);
+    }
+  }
+
+  // Destructs objs in vec, capacity is kept
+  void clear() noexcept { truncate(0); }
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() noexcept { return isInline() ? buff() : elems(head()); }
+
+  const_iterator begin() const noexcept {
+    return isInline() ? buff() : elems(head());
+  }
+
+  iterator end() noexcept { return begin() + size(); }
+
+  const_iterator end() const noexcept { return begin() + size(); }
+
+  //___________________________Getters_______________________________
+
+  size_t size() const noexcept {
+    return isInline() ? m_tag >> 1 : head()->size;
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  size_t capacity() const noexcept {
+    return isInline() ? N : head()->capacity;
+  }
+
+  pointer data() noexcept { return begin(); }
+
+  const_pointer data() const noexcept { return begin(); }
+
+  reference front() { return *begin(); }
+
+  const_reference front() const { return *begin(); }
+
+  reference back() { return *(end() - 1); }
+
+  const_reference back() const { return *(end() - 1); }
+
+  allocator_type get_allocator() const { return this->getAllocator(); }
+
+  // Heap capacity, 0 while inline
+  size_t getAlloc() const noexcept { return isInline() ? 0 : capacity(); }
+
+  static constexpr size_t inlineCapacity() noexcept { return N; }
+
+  //___________________________Misc_______________________________
+
+  // Heap blocks are swapped by their tags, inline elements one by one
+  void swap(compactVector &other) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
+    if (this == &other) return;
+    if (!isInline() && !other.isInline()) {
+      std::swap(m_tag, other.m_tag);
+    } else {
+      compactVector temp(std::move(other));
+      other.clear();
+      other.takeFrom(*this);
+      clear();
+      takeFrom(temp);
+    }
+    using std::swap;
+    swap(this->getAllocator(), other.getAllocator());
+  }
+
+  //___________________________Private func_______________________________
+
+ private:
+  static uintptr_t inlineTag(size_t size) noexcept { return size << 1 | 1; }
+
+  bool isInline() const noexcept { return m_tag & 1; }
+
+  header *head() const noexcept { return reinterpret_cast<header *>(m_tag); }
+
+  static T *elems(header *h) noexcept {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(h) + elemOffset);
+  }
+
+  void setSize(size_t size) noexcept {
+    if (isInline())
+      m_tag = inlineTag(size);
+    else
+      head()->size = static_cast<uint32_t>(size);
+  }
+
+  static size_t unitsFor(size_t cap) noexcept {
+    return (elemOffset + cap * sizeof(T) + sizeof(unit) - 1) / sizeof(unit);
+  }
+
+  header *allocateBlock(size_t cap) {
+    unitAlloc alloc(this->getAllocator());
+    header *h = reinterpret_cast<header *>(
+        unitTraits::allocate(alloc, unitsFor(cap)));
+    h->capacity = static_cast<uint32_t>(cap);
+    return h;
+  }
+
+  void freeBlock(header *h) noexcept {
+    unitAlloc alloc(this->getAllocator());
+    unitTraits::deallocate(alloc, reinterpret_cast<unit *>(h),
+                           unitsFor(h->capacity));
+  }
+
+  // Growth follows the Growth policy
+  void PbEbCheck(size_t chckSize) {
+    if (chckSize > capacity()) reserve(nextCapacity(chckSize));
+  }
+
+  size_t nextCapacity(size_t chckSize) const noexcept {
+    size_t next = Growth::next(capacity(), chckSize, sizeof(T));
+    if (next > UINT32_MAX) next = UINT32_MAX;
+    return std::max(next, chckSize);
+  }
+
+  // Cold half of emplace_back. The value is built first, params may refer
+  // to an element that the growth moves away.
+  template <typename... Ts>
+  MPC_SV_COLD void growAndEmplace(Ts &&...params) {
+    T temp(std::forward<Ts>(params)...);
+    reserve(nextCapacity(size() + 1));
+    new (end()) T(std::move(temp));
+    setSize(size() + 1);
+  }
+
+  template <typename... Ts>
+  MPC_SV_COLD bool tryGrowAndEmplace(Ts &&...params) {
+    T temp(std::forward<Ts>(params)...);
+    if (!try_reserve(nextCapacity(size() + 1))) return false;
+    new (end()) T(std::move(temp));
+    setSize(size() + 1);
+    return true;
+  }
+
+  // Strong exc. guar.
+  void moveToHeap(size_t inp) {
+    header *h = allocateBlock(inp);
+    size_t size = this->size();
+    MPC_SV_TRY { detail::relocateRange(begin(), end(), elems(h)); }
+    MPC_SV_CATCH_ALL {
+      freeBlock(h);
+      MPC_SV_RETHROW;
+    }
+    h->size = static_cast<uint32_t>(size);
+    if (!isInline()) freeBlock(head());
+    m_tag = reinterpret_cast<uintptr_t>(h);
+  }
+
+  // Destroys the elements past size
+  void truncate(size_t size) noexcept {
+    detail::destroyRange(begin() + size, end());
+    setSize(size);
+  }
+
+  template <typename It>
+  void appendRange(It first, It last, std::input_iterator_tag) {
+    for (; first != last; ++first) emplace_back(*first);
+  }
+
+  template <typename It>
+  void appendRange(It first, It last, std::forward_iterator_tag) {
+    size_t n = std::distance(first, last);
+    PbEbCheck(size() + n);
+    detail::copyRange(first, last, end());
+    setSize(size() + n);
+  }
+
+  // Takes other's heap block or moves its inline elements, this is empty
+  // and inline
+  void takeFrom(compactVector &other) {
+    if (!other.isInline()) {
+      m_tag = other.m_tag;
+    } else {
+      size_t size = other.size();
+      detail::relocateRange(other.begin(), other.end(), buff());
+      m_tag = inlineTag(size);
+    }
+    other.m_tag = inlineTag(0);
+  }
+
+  void copyAssignAlloc(const compactVector &other, std::true_type) {
+    if (!(this->getAllocator() == other.getAllocator())) {
+      clear();
+      if (!isInline()) {
+        freeBlock(head());
+        m_tag = inlineTag(0);
+      }
+    }
+    this->getAllocator() = other.getAllocator();
+  }
+
+  void copyAssignAlloc(const compactVector &, std::false_type) noexcept {}
+
+  // The allocator follows the block
+  void moveAssign(compactVector &other, std::true_type) {
+    clear();
+    if (!isInline()) freeBlock(head());
+    m_tag = inlineTag(0);
+    this->getAllocator() = std::move(other.getAllocator());
+    takeFrom(other);
+  }
+
+  // Unequal allocators cannot take over the block, elements are moved
+  void moveAssign(compactVector &other, std::false_type) {
+    if (this->getAllocator() == other.getAllocator())
+      return moveAssign(other, std::true_type());
+    assign(std::make_move_iterator(other.begin()),
+           std::make_move_iterator(other.end()));
+    other.clear();
+  }
+};  // class compact vector
+
+// outside swap function
+template <typename T, size_t N, typename Alloc, typename Growth>
+void swap(compactVector<T, N, Alloc, Growth> &avec,
+          compactVector<T, N, Alloc, Growth> &bvec) noexcept(
+    noexcept(avec.swap(bvec))) {
+  avec.swap(bvec);
+}
+
+// Erases every element matching pred, returns how many were erased
+template <typename T, size_t N, typename Alloc, typename Growth,
+          typename Pred>
+size_t erase_if(compactVector<T, N, Alloc, Growth> &vec, Pred pred) {
+  typename compactVector<T, N, Alloc, Growth>::iterator it =
+      std::remove_if(vec.begin(), vec.end(), pred);
+  size_t n = vec.end() - it;
+  vec.erase(it, vec.end());
+  return n;
+}
+
+}  // namespace mpc
+
+#endif  // MPC_COMPACTVECTOR
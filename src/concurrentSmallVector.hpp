@@ -0,0 +1,198 @@
+#ifndef MPC_CONCURRENTSMALLVECTOR
+#define MPC_CONCURRENTSMALLVECTOR
+
+// Append-only vector for many producers. push_back reserves its slot with a
+// single fetch_add; storage is an inline segment of N slots followed by heap
+// segments of N, 2N, 4N, ... slots that are never moved, so a published
+// element keeps its address. freeze() turns the result into an ordinary
+// smallVector once the producers are done.
+//
+// An element may be read by a thread that synchronizes with its producer
+// (e.g. after a join); size() counts slots that may still be under
+// construction.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "smallVector.hpp"
+
+namespace mpc {
+
+template <typename T, size_t N = 8, typename Alloc = std::allocator<T>>
+class concurrentSmallVector : private detail::allocHolder<Alloc> {
+  // Elements are moved into their slot, which cannot be given back
+  static_assert(std::is_nothrow_move_constructible<T>::value,
+                "T must be nothrow move constructible");
+
+  typedef detail::allocHolder<Alloc> allocBase;
+  typedef std::allocator_traits<Alloc> allocTraits;
+
+  // Heap segment k >= 1 holds base << (k - 1) slots
+  static const size_t base = N ? N : 1;
+  static const size_t maxSegments = 48;
+
+  // Member variables
+  std::atomic<size_t> m_size;
+  std::atomic<T *> m_segs[maxSegments];
+  alignas(alignof(T)) char m_buff[N ? sizeof(T) * N : 1];
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef Alloc allocator_type;
+
+  //====================Ctors and Dtors====================
+
+  concurrentSmallVector() : concurrentSmallVector(Alloc()) {}
+
+  // alloc is called from every producer thread, it has to be thread safe
+  explicit concurrentSmallVector(const Alloc &alloc)
+      : allocBase(alloc), m_size(0) {
+    for (size_t k = 0; k < maxSegments; k++) m_segs[k].store(nullptr);
+  }
+
+  concurrentSmallVector(const concurrentSmallVector &) = delete;
+  concurrentSmallVector &operator=(const concurrentSmallVector &) = delete;
+
+  ~concurrentSmallVector() {
+    clear();
+    freeSegments();
+  }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  // Thread safe, returns the index of the new element
+  size_t push_back(const T &inp) { return emplace_back(inp); }
+
+  size_t push_back(T &&inp) { return emplace_back(std::move(inp)); }
+
+  // Thread safe. The value is built before a slot is taken, so a throwing
+  // constructor leaves no hole. Running out of memory for a new segment
+  // after that is fatal.
+  template <typename... Ts>
+  size_t emplace_back(Ts &&...params) {
+    T temp(std::forward<Ts>(params)...);
+    size_t ind = m_size.fetch_add(1, std::memory_order_relaxed);
+    T *dest = nullptr;
+    MPC_SV_TRY { dest = slot(ind, true); }
+    MPC_SV_CATCH_ALL { std::abort(); }
+    new (dest) T(std::move(temp));
+    return ind;
+  }
+
+  // Thread safe, allocates the segments up to inp slots ahead of time. No
+  // slot is taken yet, so errors are reported as by smallVector::reserve:
+  // a failed allocation propagates, too many slots follow
+  // MPC_SV_ERROR_POLICY.
+  void reserve(size_t inp) {
+    if (inp <= N) return;
+    size_t last = segmentOf(inp - 1);
+    if (MPC_SV_UNLIKELY(last >= maxSegments))
+      detail::throwLengthError("concurrentSmallVector::reserve");
+    for (size_t k = 1; k <= last; k++) segment(k, true);
+  }
+
+  // Not thread safe
+  void clear() noexcept {
+    size_t size = m_size.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < size; i++) slot(i, false)->~T();
+    m_size.store(0, std::memory_order_relaxed);
+  }
+
+  // Not thread safe: moves the elements into one contiguous smallVector and
+  // leaves this empty
+  smallVector<T, N, Alloc> freeze() {
+    smallVector<T, N, Alloc> res(this->getAllocator());
+    size_t size = m_size.load(std::memory_order_acquire);
+    res.reserve(size);
+    for (size_t k = 0, start = 0; start < size; k++) {
+      size_t count = std::min(segmentSize(k), size - start);
+      T *seg = k ? m_segs[k].load(std::memory_order_relaxed)
+                 : reinterpret_cast<T *>(m_buff);
+      res.append(std::make_move_iterator(seg),
+                 std::make_move_iterator(seg + count));
+      start += count;
+    }
+    clear();
+    freeSegments();
+    return res;
+  }
+
+  //___________________________Getters_______________________________
+
+  // Element ind, see the header comment for when it may be read
+  reference operator[](size_t ind) { return *slot(ind, false); }
+
+  const_reference operator[](size_t ind) const {
+    return *const_cast<concurrentSmallVector *>(this)->slot(ind, false);
+  }
+
+  // Slots taken so far
+  size_t size() const noexcept {
+    return m_size.load(std::memory_order_acquire);
+  }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  allocator_type get_allocator() const { return this->getAllocator(); }
+
+  //___________________________Private func_______________________________
+
+ private:
+  static size_t segmentSize(size_t k) noexcept {
+    return k ? base << (k - 1) : N;
+  }
+
+  static size_t segmentStart(size_t k) noexcept {
+    return k ? N + base * ((size_t(1) << (k - 1)) - 1) : 0;
+  }
+
+  static size_t segmentOf(size_t ind) noexcept {
+    return ind < N ? 0 : detail::log2Floor((ind - N) / base + 1) + 1;
+  }
+
+  T *slot(size_t ind, bool create) {
+    if (ind < N) return reinterpret_cast<T *>(m_buff) + ind;
+    size_t k = segmentOf(ind);
+    return segment(k, create) + (ind - segmentStart(k));
+  }
+
+  // Producers racing for a missing segment each allocate one, the loser
+  // of the CAS frees its block. Allocation errors propagate to the caller.
+  T *segment(size_t k, bool create) {
+    T *seg = m_segs[k].load(std::memory_order_acquire);
+    if (seg || !create) return seg;
+    assert(k < maxSegments);
+    T *fresh = allocTraits::allocate(this->getAllocator(), segmentSize(k));
+    if (m_segs[k].compare_exchange_strong(seg, fresh,
+                                          std::memory_order_acq_rel,
+                                          std::memory_order_acquire))
+      return fresh;
+    allocTraits::deallocate(this->getAllocator(), fresh, segmentSize(k));
+    return seg;
+  }
+
+  void freeSegments() noexcept {
+    for (size_t k = 1; k < maxSegments; k++) {
+      T *seg = m_segs[k].load(std::memory_order_relaxed);
+      if (seg)
+        allocTraits::deallocate(this->getAllocator(), seg, segmentSize(k));
+      m_segs[k].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+};
+
+}  // namespace mpc
+
+#endif  // MPC_CONCURRENTSMALLVECTOR
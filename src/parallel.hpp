@@ -0,0 +1,357 @@
+#ifndef MPC_PARALLEL
+#define MPC_PARALLEL
+
+// Parallel sort, for_each, transform and reduce for large, spilled
+// smallVectors, on a small work-stealing pool. Vectors below
+// minParallelSize elements, or still inline, run the serial std algorithm
+// and never touch the pool.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "smallVector.hpp"
+
+namespace mpc {
+namespace parallel {
+
+// Smallest vector worth splitting, and smallest piece of work per task
+static const size_t minParallelSize = size_t(1) << 15;
+static const size_t minGrain = size_t(1) << 12;
+
+namespace detail {
+
+// Pool and queue of the worker running on this thread
+struct workerSlot {
+  const void *pool;
+  size_t index;
+};
+
+inline workerSlot &currentWorker() noexcept {
+  static thread_local workerSlot slot = {nullptr, 0};
+  return slot;
+}
+
+}  // namespace detail
+
+// Every worker owns a task deque: it pushes and pops at the back, idle
+// threads steal from the front of the others. Threads outside the pool
+// spread their tasks over all deques. A thread waiting in a taskGroup runs
+// tasks too, so nested parallelism cannot deadlock.
+class threadPool {
+  struct queue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  // Member variables
+  std::vector<std::thread> m_threads;
+  std::unique_ptr<queue[]> m_queues;
+  size_t m_nQueues;
+  std::atomic<size_t> m_pending;
+  std::atomic<size_t> m_next;
+  bool m_stop;
+  std::mutex m_sleepMutex;
+  std::condition_variable m_wake;
+
+ public:
+  //====================Ctors and Dtors====================
+
+  // workers threads besides the callers, one less than the cores by default
+  explicit threadPool(size_t workers = defaultWorkers())
+      : m_queues(new queue[workers ? workers : 1]),
+        m_nQueues(workers ? workers : 1),
+        m_pending(0),
+        m_next(0),
+        m_stop(false) {
+    m_threads.reserve(workers);
+    for (size_t i = 0; i < workers; i++)
+      m_threads.emplace_back([this, i] { workerLoop(i); });
+  }
+
+  threadPool(const threadPool &) = delete;
+  threadPool &operator=(const threadPool &) = delete;
+
+  // Runs the queued tasks to the end, then joins
+  ~threadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_sleepMutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread &t : m_threads) t.join();
+    while (runOne()) {
+    }
+  }
+
+  //___________________________Tasks_______________________________
+
+  void submit(std::function<void()> task) {
+    size_t ind = ownQueue();
+    if (ind == size_t(-1)) ind = m_next.fetch_add(1) % m_nQueues;
+    m_pending.fetch_add(1);
+    {
+      std::lock_guard<std::mutex> lock(m_queues[ind].mutex);
+      m_queues[ind].tasks.push_back(std::move(task));
+    }
+    // Taking the lock orders this against a worker about to sleep
+    { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+    m_wake.notify_one();
+  }
+
+  // Runs one queued task, the newest of our own deque or the oldest of
+  // another. False when every deque is empty.
+  bool runOne() {
+    std::function<void()> task;
+    size_t own = ownQueue();
+    if (own != size_t(-1)) popBack(own, task);
+    size_t start = own != size_t(-1) ? own + 1 : m_next.load();
+    for (size_t i = 0; !task && i < m_nQueues; i++)
+      popFront((start + i) % m_nQueues, task);
+    if (!task) return false;
+    m_pending.fetch_sub(1);
+    task();
+    return true;
+  }
+
+  // Worker threads, callers waiting on a taskGroup come on top
+  size_t size() const noexcept { return m_threads.size(); }
+
+  static size_t defaultWorkers() noexcept {
+    unsigned cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 0;
+  }
+
+  //___________________________Private func_______________________________
+
+ private:
+  size_t ownQueue() const noexcept {
+    const detail::workerSlot &slot = detail::currentWorker();
+    return slot.pool == this ? slot.index : size_t(-1);
+  }
+
+  void popBack(size_t ind, std::function<void()> &task) {
+    std::lock_guard<std::mutex> lock(m_queues[ind].mutex);
+    if (m_queues[ind].tasks.empty()) return;
+    task = std::move(m_queues[ind].tasks.back());
+    m_queues[ind].tasks.pop_back();
+  }
+
+  void popFront(size_t ind, std::function<void()> &task) {
+    std::lock_guard<std::mutex> lock(m_queues[ind].mutex);
+    if (m_queues[ind].tasks.empty()) return;
+    task = std::move(m_queues[ind].tasks.front());
+    m_queues[ind].tasks.pop_front();
+  }
+
+  void workerLoop(size_t ind) {
+    detail::workerSlot &slot = detail::currentWorker();
+    slot.pool = this;
+    slot.index = ind;
+    for (;;) {
+      if (runOne()) continue;
+      std::unique_lock<std::mutex> lock(m_sleepMutex);
+      m_wake.wait(lock, [this] { return m_stop || m_pending.load() > 0; });
+      if (m_stop) return;
+    }
+  }
+};
+
+// The pool behind the algorithms, started on first use
+inline threadPool &defaultPool() {
+  static threadPool pool;
+  return pool;
+}
+
+// Fork-join over a pool: run() queues a task, wait() helps running tasks
+// until all of the group are done and rethrows the first exception.
+class taskGroup {
+  threadPool &m_pool;
+  std::atomic<size_t> m_left;
+  std::mutex m_errorMutex;
+  std::exception_ptr m_error;
+
+ public:
+  explicit taskGroup(threadPool &pool) : m_pool(pool), m_left(0) {}
+
+  taskGroup(const taskGroup &) = delete;
+  taskGroup &operator=(const taskGroup &) = delete;
+
+  ~taskGroup() { join(); }
+
+  template <typename F>
+  void run(F f) {
+    m_left.fetch_add(1);
+    m_pool.submit([this, f] {
+#if MPC_SV_EXCEPTIONS
+      try {
+        f();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        if (!m_error) m_error = std::current_exception();
+      }
+#else
+      f();
+#endif
+      m_left.fetch_sub(1);
+    });
+  }
+
+  void wait() {
+    join();
+#if MPC_SV_EXCEPTIONS
+    if (m_error) {
+      std::exception_ptr error = m_error;
+      m_error = nullptr;
+      std::rethrow_exception(error);
+    }
+#endif
+  }
+
+ private:
+  void join() {
+    while (m_left.load() != 0)
+      if (!m_pool.runOne()) std::this_thread::yield();
+  }
+};
+
+namespace detail {
+
+inline bool runSerial(size_t size, bool onHeap, const threadPool &pool) {
+  return size < minParallelSize || !onHeap || pool.size() == 0;
+}
+
+// About four pieces per thread, at least minGrain elements each
+inline size_t pieceCount(const threadPool &pool, size_t n) noexcept {
+  return std::max<size_t>(1, std::min((pool.size() + 1) * 4, n / minGrain));
+}
+
+// f(p) for p in [0, pieces), piece 0 on the calling thread
+template <typename F>
+void forEachPiece(threadPool &pool, size_t pieces, F f) {
+  taskGroup group(pool);
+  for (size_t p = 1; p < pieces; p++) group.run([&f, p] { f(p); });
+  f(size_t(0));
+  group.wait();
+}
+
+}  // namespace detail
+
+//====================Algorithms====================
+
+// Sorts pieces in parallel, then merges them pairwise in rounds
+template <typename T, typename Alloc, typename Growth, typename Compare>
+void sort(smallVectorBase<T, Alloc, Growth> &vec, Compare comp,
+          threadPool &pool = defaultPool()) {
+  size_t n = vec.size();
+  T *data = vec.data();
+  if (detail::runSerial(n, vec.getAlloc() != 0, pool))
+    return std::sort(data, data + n, comp);
+  size_t pieces = 1;
+  while (pieces < 2 * (pool.size() + 1) && n / (pieces * 2) >= minGrain)
+    pieces *= 2;
+  taskGroup group(pool);
+  for (size_t p = 0; p < pieces; p++) {
+    T *first = data + n * p / pieces;
+    T *last = data + n * (p + 1) / pieces;
+    group.run([first, last, comp] { std::sort(first, last, comp); });
+  }
+  group.wait();
+  for (size_t width = 1; width < pieces; width *= 2) {
+    for (size_t p = 0; p < pieces; p += 2 * width) {
+      T *first = data + n * p / pieces;
+      T *mid = data + n * (p + width) / pieces;
+      T *last = data + n * (p + 2 * width) / pieces;
+      group.run([first, mid, last, comp] {
+        std::inplace_merge(first, mid, last, comp);
+      });
+    }
+    group.wait();
+  }
+}
+
+template <typename T, typename Alloc, typename Growth>
+void sort(smallVectorBase<T, Alloc, Growth> &vec) {
+  sort(vec, std::less<T>());
+}
+
+// f(element) for every element, in no particular order
+template <typename T, typename Alloc, typename Growth, typename F>
+void for_each(smallVectorBase<T, Alloc, Growth> &vec, F f,
+              threadPool &pool = defaultPool()) {
+  T *data = vec.data();
+  if (detail::runSerial(vec.size(), vec.getAlloc() != 0, pool)) {
+    std::for_each(data, data + vec.size(), f);
+    return;
+  }
+  size_t n = vec.size();
+  size_t pieces = detail::pieceCount(pool, n);
+  detail::forEachPiece(pool, pieces, [=, &f](size_t p) {
+    std::for_each(data + n * p / pieces, data + n * (p + 1) / pieces, f);
+  });
+}
+
+// dst[i] = op(src[i]), dst is resized to src. dst must not be src.
+template <typename T, typename AllocT, typename GrowthT, typename U,
+          typename AllocU, typename GrowthU, typename Op>
+void transform(const smallVectorBase<T, AllocT, GrowthT> &src,
+               smallVectorBase<U, AllocU, GrowthU> &dst, Op op,
+               threadPool &pool = defaultPool()) {
+  dst.resize(src.size());
+  const T *in = src.data();
+  U *out = dst.data();
+  if (detail::runSerial(src.size(), src.getAlloc() != 0, pool)) {
+    std::transform(in, in + src.size(), out, op);
+    return;
+  }
+  size_t n = src.size();
+  size_t pieces = detail::pieceCount(pool, n);
+  detail::forEachPiece(pool, pieces, [=, &op](size_t p) {
+    size_t first = n * p / pieces;
+    std::transform(in + first, in + n * (p + 1) / pieces, out + first, op);
+  });
+}
+
+// init op the elements, op has to be associative. Pieces are reduced in
+// parallel and then combined in order.
+template <typename T, typename Alloc, typename Growth, typename R,
+          typename Op>
+R reduce(const smallVectorBase<T, Alloc, Growth> &vec, R init, Op op,
+         threadPool &pool = defaultPool()) {
+  const T *data = vec.data();
+  size_t n = vec.size();
+  if (detail::runSerial(n, vec.getAlloc() != 0, pool)) {
+    for (size_t i = 0; i < n; i++) init = op(init, data[i]);
+    return init;
+  }
+  size_t pieces = detail::pieceCount(pool, n);
+  smallVector<R, 64> partial(pieces);
+  detail::forEachPiece(pool, pieces, [&](size_t p) {
+    size_t first = n * p / pieces;
+    size_t last = n * (p + 1) / pieces;
+    R acc = data[first];
+    for (size_t i = first + 1; i < last; i++) acc = op(acc, data[i]);
+    partial[p] = acc;
+  });
+  for (size_t p = 0; p < pieces; p++) init = op(init, partial[p]);
+  return init;
+}
+
+template <typename T, typename Alloc, typename Growth>
+T reduce(const smallVectorBase<T, Alloc, Growth> &vec) {
+  return reduce(vec, T(), std::plus<T>());
+}
+
+}  // namespace parallel
+}  // namespace mpc
+
+#endif  // MPC_PARALLEL
@@ -0,0 +1,307 @@
+#ifndef MPC_SERIALIZE
+#define MPC_SERIALIZE
+
+// Binary format for smallVectors of trivially copyable T, in native byte
+// order. A single vector is a uint64 size followed by the elements. A table
+// of vectors (writeVectors) is
+//   uint32 magic "MPCV", uint32 sizeof(T), uint64 count,
+//   uint64 offsets[count + 1] (in elements), the elements of all vectors,
+// which mappedVectors serves straight from an mmap as spans.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MPC_SV_HAS_MMAP 1
+#else
+#define MPC_SV_HAS_MMAP 0
+#endif
+
+#include "smallVector.hpp"
+#include "span.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+// "MPCV" read as a little endian uint32
+static const uint32_t serialMagic = 0x5643504d;
+
+struct serialHeader {
+  uint32_t magic;
+  uint32_t elemSize;
+  uint64_t count;
+};
+
+template <typename T>
+struct checkSerializable {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "serialization copies the bytes of T");
+  static const bool value = true;
+};
+
+inline bool writeBytes(std::ostream &os, const void *p, size_t n) {
+  os.write(static_cast<const char *>(p), static_cast<std::streamsize>(n));
+  return bool(os);
+}
+
+inline bool readBytes(std::istream &is, void *p, size_t n) {
+  is.read(static_cast<char *>(p), static_cast<std::streamsize>(n));
+  return bool(is);
+}
+
+// Replaces the contents of vec with size elements read in one go
+template <typename T, typename Alloc, typename Growth>
+bool readElements(std::istream &is, smallVectorBase<T, Alloc, Growth> &vec,
+                  uint64_t size) {
+  vec.clear();
+  if (size > UINT32_MAX) return false;
+  vec.resize_for_overwrite(static_cast<size_t>(size));
+  if (readBytes(is, vec.data(), vec.size() * sizeof(T))) return true;
+  vec.clear();
+  return false;
+}
+
+}  // namespace detail
+
+//====================Single vectors====================
+
+// uint64 size, then the elements in a single write
+template <typename T, typename Alloc, typename Growth>
+bool writeVector(std::ostream &os,
+                 const smallVectorBase<T, Alloc, Growth> &vec) {
+  static_assert(detail::checkSerializable<T>::value, "");
+  uint64_t size = vec.size();
+  return detail::writeBytes(os, &size, sizeof(size)) &&
+         detail::writeBytes(os, vec.data(), vec.size() * sizeof(T));
+}
+
+// Replaces the contents of vec, which is left empty on failure
+template <typename T, typename Alloc, typename Growth>
+bool readVector(std::istream &is, smallVectorBase<T, Alloc, Growth> &vec) {
+  static_assert(detail::checkSerializable<T>::value, "");
+  uint64_t size;
+  if (!detail::readBytes(is, &size, sizeof(size))) {
+    vec.clear();
+    return false;
+  }
+  return detail::readElements(is, vec, size);
+}
+
+//====================Tables of vectors====================
+
+// Writes the vectors of [first, last) as one table. Header and offsets go
+// out in one write, small vectors are gathered into writes of at least
+// batchBytes, larger ones are written straight from their buffer.
+template <typename It, typename = detail::requireIter<It>>
+bool writeVectors(std::ostream &os, It first, It last,
+                  size_t batchBytes = 64 * 1024) {
+  typedef typename std::iterator_traits<It>::value_type vec;
+  typedef typename vec::value_type T;
+  static_assert(detail::checkSerializable<T>::value, "");
+
+  size_t count = std::distance(first, last);
+  smallVector<uint64_t, 64> table;
+  table.resize_for_overwrite(3 + count);
+  detail::serialHeader head = {detail::serialMagic, sizeof(T), count};
+  std::memcpy(table.data(), &head, sizeof(head));
+  uint64_t offset = 0;
+  table[2] = 0;
+  It it = first;
+  for (size_t i = 0; i < count; ++i, ++it) {
+    offset += it->size();
+    table[3 + i] = offset;
+  }
+  if (!detail::writeBytes(os, table.data(), table.size() * sizeof(uint64_t)))
+    return false;
+
+  smallVector<char, 0> batch;
+  for (; first != last; ++first) {
+    size_t bytes = first->size() * sizeof(T);
+    const char *p = reinterpret_cast<const char *>(first->data());
+    if (bytes >= batchBytes) {
+      if (!detail::writeBytes(os, batch.data(), batch.size())) return false;
+      batch.clear();
+      if (!detail::writeBytes(os, p, bytes)) return false;
+      continue;
+    }
+    batch.append(p, p + bytes);
+    if (batch.size() >= batchBytes) {
+      if (!detail::writeBytes(os, batch.data(), batch.size())) return false;
+      batch.clear();
+    }
+  }
+  return detail::writeBytes(os, batch.data(), batch.size());
+}
+
+// Appends the vectors of a table to out, a container of smallVectors
+// (e.g. std::vector<smallVector<T, N>>)
+template <typename Container>
+bool readVectors(std::istream &is, Container &out) {
+  typedef typename Container::value_type vec;
+  typedef typename vec::value_type T;
+  static_assert(detail::checkSerializable<T>::value, "");
+
+  detail::serialHeader head;
+  if (!detail::readBytes(is, &head, sizeof(head)) ||
+      head.magic != detail::serialMagic || head.elemSize != sizeof(T) ||
+      head.count >= UINT32_MAX)
+    return false;
+  smallVector<uint64_t, 64> offsets;
+  offsets.resize_for_overwrite(static_cast<size_t>(head.count) + 1);
+  if (!detail::readBytes(is, offsets.data(),
+                         offsets.size() * sizeof(uint64_t)))
+    return false;
+  for (size_t i = 0; i < head.count; i++) {
+    if (offsets[i + 1] < offsets[i]) return false;
+    out.emplace_back();
+    if (!detail::readElements(is, out.back(), offsets[i + 1] - offsets[i]))
+      return false;
+  }
+  return true;
+}
+
+#if MPC_SV_HAS_MMAP
+
+// Read-only view of a table written by writeVectors, mapped from the file:
+// nothing is parsed or copied, each vector is a span into the mapping and
+// is paged in on first touch. alignof(T) must not exceed 8, the alignment
+// of the elements in the file.
+template <typename T>
+class mappedVectors {
+  static_assert(detail::checkSerializable<T>::value, "");
+  static_assert(alignof(T) <= alignof(uint64_t),
+                "elements are 8 byte aligned in the file");
+
+  // Member variables
+  void *m_map;
+  size_t m_bytes;
+  const uint64_t *m_offsets;
+  const T *m_elems;
+  size_t m_count;
+
+ public:
+  //====================Ctors and Dtors====================
+
+  mappedVectors() noexcept
+      : m_map(nullptr),
+        m_bytes(0),
+        m_offsets(nullptr),
+        m_elems(nullptr),
+        m_count(0) {}
+
+  // Check is_open() for the result
+  explicit mappedVectors(const char *path) : mappedVectors() { open(path); }
+
+  mappedVectors(const mappedVectors &) = delete;
+  mappedVectors &operator=(const mappedVectors &) = delete;
+
+  mappedVectors(mappedVectors &&other) noexcept : mappedVectors() {
+    swap(other);
+  }
+
+  mappedVectors &operator=(mappedVectors &&other) noexcept {
+    if (this != &other) {
+      close();
+      swap(other);
+    }
+    return *this;
+  }
+
+  ~mappedVectors() { close(); }
+
+  //___________________________File_______________________________
+
+  // Maps path, false when it cannot be mapped or is not a table of T
+  bool open(const char *path) {
+    close();
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    void *map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+      map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                 MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+    m_map = map;
+    m_bytes = static_cast<size_t>(st.st_size);
+    if (validate()) return true;
+    close();
+    return false;
+  }
+
+  void close() noexcept {
+    if (m_map) munmap(m_map, m_bytes);
+    m_map = nullptr;
+    m_bytes = 0;
+    m_offsets = nullptr;
+    m_elems = nullptr;
+    m_count = 0;
+  }
+
+  bool is_open() const noexcept { return m_map != nullptr; }
+
+  //___________________________Getters_______________________________
+
+  // Vector ind of the table
+  span<const T> operator[](size_t ind) const noexcept {
+    return span<const T>(m_elems + m_offsets[ind],
+                         m_elems + m_offsets[ind + 1]);
+  }
+
+  // Number of vectors
+  size_t size() const noexcept { return m_count; }
+
+  bool empty() const noexcept { return m_count == 0; }
+
+  void swap(mappedVectors &other) noexcept {
+    std::swap(m_map, other.m_map);
+    std::swap(m_bytes, other.m_bytes);
+    std::swap(m_offsets, other.m_offsets);
+    std::swap(m_elems, other.m_elems);
+    std::swap(m_count, other.m_count);
+  }
+
+  //___________________________Private func_______________________________
+
+ private:
+  // Header, offsets and elements have to fit in the mapping, offsets
+  // may not decrease
+  bool validate() noexcept {
+    detail::serialHeader head;
+    if (m_bytes < sizeof(head)) return false;
+    std::memcpy(&head, m_map, sizeof(head));
+    size_t words = (m_bytes - sizeof(head)) / sizeof(uint64_t);
+    if (head.magic != detail::serialMagic || head.elemSize != sizeof(T) ||
+        head.count >= words)
+      return false;
+    const char *base = static_cast<const char *>(m_map);
+    m_offsets = reinterpret_cast<const uint64_t *>(base + sizeof(head));
+    m_count = static_cast<size_t>(head.count);
+    size_t dataBytes =
+        m_bytes - sizeof(head) - (m_count + 1) * sizeof(uint64_t);
+    for (size_t i = 0; i < m_count; i++)
+      if (m_offsets[i + 1] < m_offsets[i]) return false;
+    if (m_offsets[0] != 0 || m_offsets[m_count] > dataBytes / sizeof(T))
+      return false;
+    m_elems = reinterpret_cast<const T *>(m_offsets + m_count + 1);
+    return true;
+  }
+};
+
+#endif  // MPC_SV_HAS_MMAP
+
+}  // namespace mpc
+
+#endif  // MPC_SERIALIZE
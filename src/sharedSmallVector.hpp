@@ -0,0 +1,444 @@
+#ifndef MPC_SHAREDSMALLVECTOR
+#define MPC_SHAREDSMALLVECTOR
+
+// smallVector whose heap block is shared between copies: copying a spilled
+// vector bumps a reference count in front of the elements, and the first
+// mutation of a shared block copies it. Inline elements are copied by value
+// as usual. Reads go through the const overloads (cbegin, const operator[]);
+// the non-const ones detach first, and a reference they return is only
+// safe to write through until the vector is copied again. The count is
+// atomic, copies may be handed to other threads.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "compactVector.hpp"
+#include "smallVector.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+// Heap block of a sharedSmallVector, the elements follow
+struct sharedHeader {
+  std::atomic<size_t> refs;
+  size_t capacity;
+};
+
+}  // namespace detail
+
+template <typename T, size_t N = 8, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+class sharedSmallVector : private detail::allocHolder<Alloc>,
+                          private detail::compactBuffer<T, N> {
+  static_assert(N <= UINT32_MAX, "inline capacity must fit in 32 bits");
+  static_assert(std::is_same<typename Alloc::value_type, T>::value,
+                "Alloc::value_type must be T");
+
+  typedef detail::allocHolder<Alloc> allocBase;
+  typedef detail::compactBuffer<T, N> buffBase;
+  typedef std::allocator_traits<Alloc> allocTraits;
+  typedef detail::sharedHeader header;
+
+  static const size_t unitAlign =
+      alignof(T) > alignof(header) ? alignof(T) : alignof(header);
+  typedef detail::compactUnit<unitAlign> unit;
+  typedef typename allocTraits::template rebind_alloc<unit> unitAlloc;
+  typedef std::allocator_traits<unitAlloc> unitTraits;
+
+  // Elements start at the first T aligned offset after the header
+  static const size_t elemOffset =
+      (sizeof(header) + alignof(T) - 1) / alignof(T) * alignof(T);
+
+  using buffBase::buff;
+
+  // Member variables
+  // The inline slots or the elements of the heap block
+  T *m_data;
+  uint32_t m_size;
+  uint32_t m_alloc;
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+  typedef Alloc allocator_type;
+
+  //====================Ctors and Dtors====================
+
+  sharedSmallVector() : sharedSmallVector(Alloc()) {}
+
+  explicit sharedSmallVector(const Alloc &alloc)
+      : allocBase(alloc), m_data(buff()), m_size(0), m_alloc(N) {}
+
+  // sz value-initialized elements
+  sharedSmallVector(const size_t sz, const Alloc &alloc = Alloc())
+      : sharedSmallVector(alloc) {
+    resize(sz);
+  }
+
+  // O(1) for a heap block, which becomes shared
+  sharedSmallVector(const sharedSmallVector &other)
+      : sharedSmallVector(allocTraits::select_on_container_copy_construction(
+            other.getAllocator())) {
+    copyFrom(other);
+  }
+
+  // Range constructor
+  template <typename It, typename = detail::requireIter<It>>
+  sharedSmallVector(It first, It last, const Alloc &alloc = Alloc())
+      : sharedSmallVector(alloc) {
+    append(first, last);
+  }
+
+  // Steals the heap block, shared or not, or moves the inline elements
+  sharedSmallVector(sharedSmallVector &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value)
+      : sharedSmallVector(other.getAllocator()) {
+    takeFrom(other);
+  }
+
+  sharedSmallVector(std::initializer_list<T> init,
+                    const Alloc &alloc = Alloc())
+      : sharedSmallVector(alloc) {
+    append(init.begin(), init.end());
+  }
+
+  ~sharedSmallVector() { reset(); }
+
+  //___________________________Operators_______________________________
+
+  // Copy op =, shares other's heap block
+  sharedSmallVector &operator=(const sharedSmallVector &other) {
+    if (this == &other) return *this;
+    reset();
+    if (allocTraits::propagate_on_container_copy_assignment::value)
+      this->getAllocator() = other.getAllocator();
+    copyFrom(other);
+    return *this;
+  }
+
+  // Move op =, unequal allocators that do not propagate copy the elements
+  sharedSmallVector &operator=(sharedSmallVector &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value &&
+      (allocTraits::propagate_on_container_move_assignment::value ||
+       detail::allocAlwaysEqual<Alloc>::value)) {
+    if (this == &other) return *this;
+    reset();
+    if (allocTraits::propagate_on_container_move_assignment::value ||
+        this->getAllocator() == other.getAllocator()) {
+      this->getAllocator() = std::move(other.getAllocator());
+      takeFrom(other);
+    } else {
+      append(other.cbegin(), other.cend());
+      other.reset();
+    }
+    return *this;
+  }
+
+  sharedSmallVector &operator=(std::initializer_list<T> init) {
+    reset();
+    append(init.begin(), init.end());
+    return *this;
+  }
+
+  // Detaches a shared block
+  reference operator[](size_t ind) { return data()[ind]; }
+
+  const_reference operator[](size_t ind) const { return m_data[ind]; }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  void push_back(const T &inp) { emplace_back(inp); }
+
+  void push_back(T &&inp) { emplace_back(std::move(inp)); }
+
+  // Emplace back, detaching and growth are kept out of line
+  template <typename... Ts>
+  reference emplace_back(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(m_size == m_alloc || shared()))
+      return growAndEmplace(std::forward<Ts>(params)...);
+    T *res = new (m_data + m_size) T(std::forward<Ts>(params)...);
+    m_size++;
+    return *res;
+  }
+
+  // Appends [first, last), the range must not point into this vector
+  template <typename It, typename = detail::requireIter<It>>
+  void append(It first, It last) {
+    appendRange(first, last,
+                typename std::iterator_traits<It>::iterator_category());
+  }
+
+  void pop_back() {
+    assert(!empty());
+    detach(m_alloc);
+    m_data[--m_size].~T();
+  }
+
+  // New elements are value-initialized
+  void resize(size_t size) {
+    if (size < m_size) return truncate(size);
+    reserve(size);
+    for (; m_size < size; m_size++) new (m_data + m_size) T();
+  }
+
+  void resize(size_t size, const T &val) {
+    if (size < m_size) return truncate(size);
+    T copy(val);
+    reserve(size);
+    for (; m_size < size; m_size++) new (m_data + m_size) T(copy);
+  }
+
+  // Reserves at least inp in an unshared block. Strong exc. guar.
+  void reserve(size_t inp) {
+    if (inp > UINT32_MAX)
+      detail::throwLengthError("sharedSmallVector::reserve");
+    detach(std::max<size_t>(inp, m_alloc));
+  }
+
+  // A shared block is only released, an own one keeps its capacity
+  void clear() noexcept {
+    if (shared()) return reset();
+    detail::destroyRange(m_data, m_data + m_size);
+    m_size = 0;
+  }
+
+  //___________________________Iterator_______________________________
+
+  // Detaches a shared block
+  iterator begin() { return data(); }
+
+  const_iterator begin() const noexcept { return m_data; }
+
+  iterator end() { return data() + m_size; }
+
+  const_iterator end() const noexcept { return m_data + m_size; }
+
+  const_iterator cbegin() const noexcept { return m_data; }
+
+  const_iterator cend() const noexcept { return m_data + m_size; }
+
+  //___________________________Getters_______________________________
+
+  size_t size() const noexcept { return m_size; }
+
+  bool empty() const noexcept { return m_size == 0; }
+
+  size_t capacity() const noexcept { return m_alloc; }
+
+  // Detaches a shared block
+  pointer data() {
+    detach(m_alloc);
+    return m_data;
+  }
+
+  const_pointer data() const noexcept { return m_data; }
+
+  reference front() { return data()[0]; }
+
+  const_reference front() const { return m_data[0]; }
+
+  reference back() { return data()[m_size - 1]; }
+
+  const_reference back() const { return m_data[m_size - 1]; }
+
+  allocator_type get_allocator() const { return this->getAllocator(); }
+
+  // Heap capacity, 0 while inline
+  size_t getAlloc() const noexcept { return onHeap() ? m_alloc : 0; }
+
+  // Vectors sharing the heap block, 0 while inline
+  size_t use_count() const noexcept {
+    return onHeap() ? head()->refs.load(std::memory_order_acquire) : 0;
+  }
+
+  static constexpr size_t inlineCapacity() noexcept { return N; }
+
+  //___________________________Misc_______________________________
+
+  void swap(sharedSmallVector &other) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
+    if (this == &other) return;
+    sharedSmallVector temp(std::move(other));
+    other.takeFrom(*this);
+    takeFrom(temp);
+    using std::swap;
+    swap(this->getAllocator(), other.getAllocator());
+  }
+
+  //___________________________Private func_______________________________
+
+ private:
+  bool onHeap() const noexcept { return m_data != buff(); }
+
+  // Another vector holds the block too
+  bool shared() const noexcept {
+    return onHeap() && head()->refs.load(std::memory_order_acquire) != 1;
+  }
+
+  header *head() const noexcept {
+    return reinterpret_cast<header *>(reinterpret_cast<char *>(m_data) -
+                                      elemOffset);
+  }
+
+  static T *elems(header *h) noexcept {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(h) + elemOffset);
+  }
+
+  static size_t unitsFor(size_t cap) noexcept {
+    return (elemOffset + cap * sizeof(T) + sizeof(unit) - 1) / sizeof(unit);
+  }
+
+  header *allocateBlock(size_t cap) {
+    unitAlloc alloc(this->getAllocator());
+    header *h = reinterpret_cast<header *>(
+        unitTraits::allocate(alloc, unitsFor(cap)));
+    new (&h->refs) std::atomic<size_t>(1);
+    h->capacity = cap;
+    return h;
+  }
+
+  void freeBlock(header *h) noexcept {
+    size_t cap = h->capacity;
+    h->refs.~atomic();
+    unitAlloc alloc(this->getAllocator());
+    unitTraits::deallocate(alloc, reinterpret_cast<unit *>(h), unitsFor(cap));
+  }
+
+  // Drops the elements or our reference, the last one frees the block.
+  // Leaves the vector empty and inline.
+  void reset() noexcept {
+    if (!onHeap()) {
+      detail::destroyRange(m_data, m_data + m_size);
+    } else if (head()->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      detail::destroyRange(m_data, m_data + m_size);
+      freeBlock(head());
+    }
+    m_data = buff();
+    m_size = 0;
+    m_alloc = N;
+  }
+
+  // Makes the elements our own with room for cap, copying a shared block
+  // and moving an own one. Strong exc. guar.
+  void detach(size_t cap) {
+    bool share = shared();
+    if (!share && cap <= m_alloc) return;
+    header *h = allocateBlock(cap);
+    T *dest = elems(h);
+    MPC_SV_TRY {
+      if (share)
+        detail::copyRange(m_data, m_data + m_size, dest);
+      else
+        detail::relocateRange(m_data, m_data + m_size, dest);
+    }
+    MPC_SV_CATCH_ALL {
+      freeBlock(h);
+      MPC_SV_RETHROW;
+    }
+    uint32_t size = m_size;
+    if (share)
+      reset();
+    else if (onHeap())
+      freeBlock(head());
+    m_data = dest;
+    m_size = size;
+    m_alloc = static_cast<uint32_t>(cap);
+  }
+
+  size_t nextCapacity(size_t chckSize) const noexcept {
+    size_t next = Growth::next(m_alloc, chckSize, sizeof(T));
+    if (next > UINT32_MAX) next = UINT32_MAX;
+    return std::max(next, chckSize);
+  }
+
+  // Cold half of emplace_back. The value is built first, params may refer
+  // to an element of the block that is about to be left.
+  template <typename... Ts>
+  MPC_SV_COLD reference growAndEmplace(Ts &&...params) {
+    T temp(std::forward<Ts>(params)...);
+    size_t need = m_size + 1;
+    if (need > UINT32_MAX) detail::throwLengthError("sharedSmallVector");
+    detach(need > m_alloc ? nextCapacity(need) : m_alloc);
+    T *res = new (m_data + m_size) T(std::move(temp));
+    m_size++;
+    return *res;
+  }
+
+  template <typename It>
+  void appendRange(It first, It last, std::input_iterator_tag) {
+    for (; first != last; ++first) emplace_back(*first);
+  }
+
+  template <typename It>
+  void appendRange(It first, It last, std::forward_iterator_tag) {
+    size_t need = m_size + std::distance(first, last);
+    if (need > UINT32_MAX) detail::throwLengthError("sharedSmallVector");
+    detach(need > m_alloc ? nextCapacity(need) : m_alloc);
+    detail::copyRange(first, last, m_data + m_size);
+    m_size = static_cast<uint32_t>(need);
+  }
+
+  void truncate(size_t size) {
+    if (shared() && size == 0) return reset();
+    detach(m_alloc);
+    detail::destroyRange(m_data + size, m_data + m_size);
+    m_size = static_cast<uint32_t>(size);
+  }
+
+  // Shares other's block when our allocator can free it, this is empty
+  // and inline
+  void copyFrom(const sharedSmallVector &other) {
+    if (other.onHeap() && this->getAllocator() == other.getAllocator()) {
+      other.head()->refs.fetch_add(1, std::memory_order_relaxed);
+      m_data = other.m_data;
+      m_size = other.m_size;
+      m_alloc = other.m_alloc;
+    } else {
+      append(other.cbegin(), other.cend());
+    }
+  }
+
+  // Takes other's block or moves its inline elements, this is empty and
+  // inline
+  void takeFrom(sharedSmallVector &other) {
+    if (other.onHeap()) {
+      m_data = other.m_data;
+      m_alloc = other.m_alloc;
+    } else {
+      detail::relocateRange(other.m_data, other.m_data + other.m_size, buff());
+    }
+    m_size = other.m_size;
+    other.m_data = other.buff();
+    other.m_size = 0;
+    other.m_alloc = N;
+  }
+};  // class shared small vector
+
+// outside swap function
+template <typename T, size_t N, typename Alloc, typename Growth>
+void swap(sharedSmallVector<T, N, Alloc, Growth> &avec,
+          sharedSmallVector<T, N, Alloc, Growth> &bvec) noexcept(
+    noexcept(avec.swap(bvec))) {
+  avec.swap(bvec);
+}
+
+}  // namespace mpc
+
+#endif  // MPC_SHAREDSMALLVECTOR
@@ -0,0 +1,610 @@
+#ifndef MPC_SIMD
+#define MPC_SIMD
+
+// Bulk kernels for arithmetic element types: fill, find, count, min, max,
+// sum and elementwise add/mul. float, double, int32_t and uint32_t use
+// AVX2 or SSE4.2 picked at runtime on x86 (GCC/clang), NEON on AArch64;
+// every other type and platform gets the scalar loops. Vectorized float sums
+// add in a different order than std::accumulate, and min/max of ranges
+// holding NaN are unspecified.
+//
+// The smallVector overloads know N: when the whole inline buffer is
+// narrower than one AVX2 register the vector kernels would only run their
+// scalar tail, so an inline vector takes a loop with a compile-time trip
+// count instead, unrolled fully and without the dispatch.
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "smallVector.hpp"
+
+#if (defined(__GNUC__) || defined(__clang__)) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define MPC_SIMD_X86 1
+#include <immintrin.h>
+#else
+#define MPC_SIMD_X86 0
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define MPC_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define MPC_SIMD_NEON 0
+#endif
+
+namespace mpc {
+namespace simd {
+
+// Inline buffers up to this size take the fully unrolled loops
+static const size_t unrollBytes = 32;
+
+namespace detail {
+
+// Element types with vector kernels
+template <typename T>
+struct hasLanes
+    : std::integral_constant<bool,
+                             (MPC_SIMD_X86 || MPC_SIMD_NEON) &&
+                                 (std::is_same<T, float>::value ||
+                                  std::is_same<T, int32_t>::value ||
+                                  std::is_same<T, uint32_t>::value ||
+                                  (MPC_SIMD_X86 &&
+                                   std::is_same<T, double>::value))> {};
+
+namespace scalar {
+
+template <typename T>
+void fill(T *p, size_t n, T val) {
+  for (size_t i = 0; i < n; i++) p[i] = val;
+}
+
+template <typename T>
+const T *find(const T *p, size_t n, T val) {
+  for (size_t i = 0; i < n; i++)
+    if (p[i] == val) return p + i;
+  return p + n;
+}
+
+template <typename T>
+size_t count(const T *p, size_t n, T val) {
+  size_t res = 0;
+  for (size_t i = 0; i < n; i++) res += p[i] == val;
+  return res;
+}
+
+template <typename T>
+T sum(const T *p, size_t n) {
+  T res = T();
+  for (size_t i = 0; i < n; i++) res += p[i];
+  return res;
+}
+
+template <typename T>
+T min(const T *p, size_t n) {
+  T res = p[0];
+  for (size_t i = 1; i < n; i++)
+    if (p[i] < res) res = p[i];
+  return res;
+}
+
+template <typename T>
+T max(const T *p, size_t n) {
+  T res = p[0];
+  for (size_t i = 1; i < n; i++)
+    if (res < p[i]) res = p[i];
+  return res;
+}
+
+template <typename T>
+void add(T *dst, const T *src, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] += src[i];
+}
+
+template <typename T>
+void mul(T *dst, const T *src, size_t n) {
+  for (size_t i = 0; i < n; i++) dst[i] *= src[i];
+}
+
+}  // namespace scalar
+
+// The scalar loops with the trip count bounded by N
+namespace fixed {
+
+template <size_t N, typename T>
+void fill(T *p, size_t n, T val) {
+  for (size_t i = 0; i < N; i++)
+    if (i < n) p[i] = val;
+}
+
+template <size_t N, typename T>
+const T *find(const T *p, size_t n, T val) {
+  for (size_t i = 0; i < N; i++)
+    if (i < n && p[i] == val) return p + i;
+  return p + n;
+}
+
+template <size_t N, typename T>
+size_t count(const T *p, size_t n, T val) {
+  size_t res = 0;
+  for (size_t i = 0; i < N; i++)
+    if (i < n) res += p[i] == val;
+  return res;
+}
+
+template <size_t N, typename T>
+T sum(const T *p, size_t n) {
+  T res = T();
+  for (size_t i = 0; i < N; i++)
+    if (i < n) res += p[i];
+  return res;
+}
+
+template <size_t N, typename T>
+T min(const T *p, size_t n) {
+  T res = p[0];
+  for (size_t i = 1; i < N; i++)
+    if (i < n && p[i] < res) res = p[i];
+  return res;
+}
+
+template <size_t N, typename T>
+T max(const T *p, size_t n) {
+  T res = p[0];
+  for (size_t i = 1; i < N; i++)
+    if (i < n && res < p[i]) res = p[i];
+  return res;
+}
+
+template <size_t N, typename T>
+void add(T *dst, const T *src, size_t n) {
+  for (size_t i = 0; i < N; i++)
+    if (i < n) dst[i] += src[i];
+}
+
+template <size_t N, typename T>
+void mul(T *dst, const T *src, size_t n) {
+  for (size_t i = 0; i < N; i++)
+    if (i < n) dst[i] *= src[i];
+}
+
+}  // namespace fixed
+
+#if MPC_SIMD_X86
+
+enum { scalarLevel, sse42Level, avx2Level };
+
+inline int detectLevel() noexcept {
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return avx2Level;
+  if (__builtin_cpu_supports("sse4.2")) return sse42Level;
+  return scalarLevel;
+}
+
+inline int cpuLevel() noexcept {
+  static const int level = detectLevel();
+  return level;
+}
+
+#if defined(__clang__)
+#pragma clang attribute push(__attribute__((target("avx2"))), \
+                             apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+namespace avx2 {
+
+template <typename T>
+struct lanes;
+
+template <>
+struct lanes<float> {
+  typedef __m256 reg;
+  static const size_t width = 8;
+  static reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static void store(float *p, reg v) { _mm256_storeu_ps(p, v); }
+  static reg set1(float v) { return _mm256_set1_ps(v); }
+  static reg zero() { return _mm256_setzero_ps(); }
+  static reg add(reg a, reg b) { return _mm256_add_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_ps(a, b); }
+  static reg min(reg a, reg b) { return _mm256_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_ps(a, b); }
+  static unsigned eqMask(reg a, reg b) {
+    return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ));
+  }
+};
+
+template <>
+struct lanes<double> {
+  typedef __m256d reg;
+  static const size_t width = 4;
+  static reg load(const double *p) { return _mm256_loadu_pd(p); }
+  static void store(double *p, reg v) { _mm256_storeu_pd(p, v); }
+  static reg set1(double v) { return _mm256_set1_pd(v); }
+  static reg zero() { return _mm256_setzero_pd(); }
+  static reg add(reg a, reg b) { return _mm256_add_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mul_pd(a, b); }
+  static reg min(reg a, reg b) { return _mm256_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_pd(a, b); }
+  static unsigned eqMask(reg a, reg b) {
+    return _mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ));
+  }
+};
+
+// Shared by int32_t and uint32_t, only min/max care about the sign
+template <typename T>
+struct intLanes {
+  typedef __m256i reg;
+  static const size_t width = 8;
+  static reg load(const T *p) {
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+  }
+  static void store(T *p, reg v) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), v);
+  }
+  static reg set1(T v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+  static reg zero() { return _mm256_setzero_si256(); }
+  static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+  static reg mul(reg a, reg b) { return _mm256_mullo_epi32(a, b); }
+  static unsigned eqMask(reg a, reg b) {
+    return _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b)));
+  }
+};
+
+template <>
+struct lanes<int32_t> : intLanes<int32_t> {
+  static reg min(reg a, reg b) { return _mm256_min_epi32(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_epi32(a, b); }
+};
+
+template <>
+struct lanes<uint32_t> : intLanes<uint32_t> {
+  static reg min(reg a, reg b) { return _mm256_min_epu32(a, b); }
+  static reg max(reg a, reg b) { return _mm256_max_epu32(a, b); }
+};
+
+#include "simdKernels.inc"
+
+}  // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push(__attribute__((target("sse4.2"))), \
+                             apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("sse4.2")
+#endif
+
+namespace sse42 {
+
+template <typename T>
+struct lanes;
+
+template <>
+struct lanes<float> {
+  typedef __m128 reg;
+  static const size_t width = 4;
+  static reg load(const float *p) { return _mm_loadu_ps(p); }
+  static void store(float *p, reg v) { _mm_storeu_ps(p, v); }
+  static reg set1(float v) { return _mm_set1_ps(v); }
+  static reg zero() { return _mm_setzero_ps(); }
+  static reg add(reg a, reg b) { return _mm_add_ps(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_ps(a, b); }
+  static reg min(reg a, reg b) { return _mm_min_ps(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_ps(a, b); }
+  static unsigned eqMask(reg a, reg b) {
+    return _mm_movemask_ps(_mm_cmpeq_ps(a, b));
+  }
+};
+
+template <>
+struct lanes<double> {
+  typedef __m128d reg;
+  static const size_t width = 2;
+  static reg load(const double *p) { return _mm_loadu_pd(p); }
+  static void store(double *p, reg v) { _mm_storeu_pd(p, v); }
+  static reg set1(double v) { return _mm_set1_pd(v); }
+  static reg zero() { return _mm_setzero_pd(); }
+  static reg add(reg a, reg b) { return _mm_add_pd(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mul_pd(a, b); }
+  static reg min(reg a, reg b) { return _mm_min_pd(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_pd(a, b); }
+  static unsigned eqMask(reg a, reg b) {
+    return _mm_movemask_pd(_mm_cmpeq_pd(a, b));
+  }
+};
+
+template <typename T>
+struct intLanes {
+  typedef __m128i reg;
+  static const size_t width = 4;
+  static reg load(const T *p) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+  }
+  static void store(T *p, reg v) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+  }
+  static reg set1(T v) { return _mm_set1_epi32(static_cast<int>(v)); }
+  static reg zero() { return _mm_setzero_si128(); }
+  static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+  static reg mul(reg a, reg b) { return _mm_mullo_epi32(a, b); }
+  static unsigned eqMask(reg a, reg b) {
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b)));
+  }
+};
+
+template <>
+struct lanes<int32_t> : intLanes<int32_t> {
+  static reg min(reg a, reg b) { return _mm_min_epi32(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_epi32(a, b); }
+};
+
+template <>
+struct lanes<uint32_t> : intLanes<uint32_t> {
+  static reg min(reg a, reg b) { return _mm_min_epu32(a, b); }
+  static reg max(reg a, reg b) { return _mm_max_epu32(a, b); }
+};
+
+#include "simdKernels.inc"
+
+}  // namespace sse42
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+// Best kernel set the CPU supports
+#define MPC_SIMD_CALL(fn, ...)                            \
+  (cpuLevel() == avx2Level    ? avx2::fn(__VA_ARGS__)  \
+   : cpuLevel() == sse42Level ? sse42::fn(__VA_ARGS__) \
+                              : scalar::fn(__VA_ARGS__))
+
+#elif MPC_SIMD_NEON
+
+// Part of the AArch64 baseline, no dispatch needed
+namespace neon {
+
+template <typename T>
+struct lanes;
+
+// Lane i of an all-ones/all-zeros compare result becomes bit i
+inline unsigned maskBits(uint32x4_t m) {
+  static const uint32_t bits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(m, vld1q_u32(bits)));
+}
+
+template <>
+struct lanes<float> {
+  typedef float32x4_t reg;
+  static const size_t width = 4;
+  static reg load(const float *p) { return vld1q_f32(p); }
+  static void store(float *p, reg v) { vst1q_f32(p, v); }
+  static reg set1(float v) { return vdupq_n_f32(v); }
+  static reg zero() { return vdupq_n_f32(0); }
+  static reg add(reg a, reg b) { return vaddq_f32(a, b); }
+  static reg mul(reg a, reg b) { return vmulq_f32(a, b); }
+  static reg min(reg a, reg b) { return vminq_f32(a, b); }
+  static reg max(reg a, reg b) { return vmaxq_f32(a, b); }
+  static unsigned eqMask(reg a, reg b) { return maskBits(vceqq_f32(a, b)); }
+};
+
+template <>
+struct lanes<int32_t> {
+  typedef int32x4_t reg;
+  static const size_t width = 4;
+  static reg load(const int32_t *p) { return vld1q_s32(p); }
+  static void store(int32_t *p, reg v) { vst1q_s32(p, v); }
+  static reg set1(int32_t v) { return vdupq_n_s32(v); }
+  static reg zero() { return vdupq_n_s32(0); }
+  static reg add(reg a, reg b) { return vaddq_s32(a, b); }
+  static reg mul(reg a, reg b) { return vmulq_s32(a, b); }
+  static reg min(reg a, reg b) { return vminq_s32(a, b); }
+  static reg max(reg a, reg b) { return vmaxq_s32(a, b); }
+  static unsigned eqMask(reg a, reg b) { return maskBits(vceqq_s32(a, b)); }
+};
+
+template <>
+struct lanes<uint32_t> {
+  typedef uint32x4_t reg;
+  static const size_t width = 4;
+  static reg load(const uint32_t *p) { return vld1q_u32(p); }
+  static void store(uint32_t *p, reg v) { vst1q_u32(p, v); }
+  static reg set1(uint32_t v) { return vdupq_n_u32(v); }
+  static reg zero() { return vdupq_n_u32(0); }
+  static reg add(reg a, reg b) { return vaddq_u32(a, b); }
+  static reg mul(reg a, reg b) { return vmulq_u32(a, b); }
+  static reg min(reg a, reg b) { return vminq_u32(a, b); }
+  static reg max(reg a, reg b) { return vmaxq_u32(a, b); }
+  static unsigned eqMask(reg a, reg b) { return maskBits(vceqq_u32(a, b)); }
+};
+
+#include "simdKernels.inc"
+
+}  // namespace neon
+
+#define MPC_SIMD_CALL(fn, ...) neon::fn(__VA_ARGS__)
+
+#else
+
+#define MPC_SIMD_CALL(fn, ...) scalar::fn(__VA_ARGS__)
+
+#endif
+
+// Vector kernels when T has lanes, scalar loops otherwise
+template <typename T, bool = hasLanes<T>::value>
+struct kernels {
+  static void fill(T *p, size_t n, T val) { scalar::fill(p, n, val); }
+  static const T *find(const T *p, size_t n, T val) {
+    return scalar::find(p, n, val);
+  }
+  static size_t count(const T *p, size_t n, T val) {
+    return scalar::count(p, n, val);
+  }
+  static T sum(const T *p, size_t n) { return scalar::sum(p, n); }
+  static T min(const T *p, size_t n) { return scalar::min(p, n); }
+  static T max(const T *p, size_t n) { return scalar::max(p, n); }
+  static void add(T *dst, const T *src, size_t n) { scalar::add(dst, src, n); }
+  static void mul(T *dst, const T *src, size_t n) { scalar::mul(dst, src, n); }
+};
+
+template <typename T>
+struct kernels<T, true> {
+  static void fill(T *p, size_t n, T val) { MPC_SIMD_CALL(fill, p, n, val); }
+  static const T *find(const T *p, size_t n, T val) {
+    return MPC_SIMD_CALL(find, p, n, val);
+  }
+  static size_t count(const T *p, size_t n, T val) {
+    return MPC_SIMD_CALL(count, p, n, val);
+  }
+  static T sum(const T *p, size_t n) { return MPC_SIMD_CALL(sum, p, n); }
+  static T min(const T *p, size_t n) { return MPC_SIMD_CALL(min, p, n); }
+  static T max(const T *p, size_t n) { return MPC_SIMD_CALL(max, p, n); }
+  static void add(T *dst, const T *src, size_t n) {
+    MPC_SIMD_CALL(add, dst, src, n);
+  }
+  static void mul(T *dst, const T *src, size_t n) {
+    MPC_SIMD_CALL(mul, dst, src, n);
+  }
+};
+
+#undef MPC_SIMD_CALL
+
+// Small inline smallVectors use the fixed loops
+template <typename T, size_t N>
+struct unrolled
+    : std::integral_constant<bool, N != 0 && N * sizeof(T) <= unrollBytes> {};
+
+}  // namespace detail
+
+// Kernel set in use, for benchmark labels
+inline const char *isaName() noexcept {
+#if MPC_SIMD_X86
+  switch (detail::cpuLevel()) {
+    case detail::avx2Level:
+      return "avx2";
+    case detail::sse42Level:
+      return "sse4.2";
+  }
+  return "scalar";
+#elif MPC_SIMD_NEON
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
+
+//====================Pointer kernels====================
+
+template <typename T>
+void fill(T *p, size_t n, T val) {
+  detail::kernels<T>::fill(p, n, val);
+}
+
+// First element equal to val, p + n when there is none
+template <typename T>
+const T *find(const T *p, size_t n, T val) {
+  return detail::kernels<T>::find(p, n, val);
+}
+
+template <typename T>
+size_t count(const T *p, size_t n, T val) {
+  return detail::kernels<T>::count(p, n, val);
+}
+
+template <typename T>
+T sum(const T *p, size_t n) {
+  return detail::kernels<T>::sum(p, n);
+}
+
+// n must not be 0
+template <typename T>
+T min(const T *p, size_t n) {
+  assert(n);
+  return detail::kernels<T>::min(p, n);
+}
+
+template <typename T>
+T max(const T *p, size_t n) {
+  assert(n);
+  return detail::kernels<T>::max(p, n);
+}
+
+// dst[i] += src[i]
+template <typename T>
+void add(T *dst, const T *src, size_t n) {
+  detail::kernels<T>::add(dst, src, n);
+}
+
+// dst[i] *= src[i]
+template <typename T>
+void mul(T *dst, const T *src, size_t n) {
+  detail::kernels<T>::mul(dst, src, n);
+}
+
+//====================smallVector kernels====================
+
+// Picks the fixed loop for small inline vectors, the pointer kernel
+// otherwise
+#define MPC_SIMD_VEC(fn, vec, ...)                                       \
+  (detail::unrolled<T, N>::value && !(vec).getAlloc()                    \
+       ? detail::fixed::fn<detail::unrolled<T, N>::value ? N : 1>(       \
+             __VA_ARGS__)                                                \
+       : fn(__VA_ARGS__))
+
+template <typename T, size_t N, typename A, typename G>
+void fill(smallVector<T, N, A, G> &vec, T val) {
+  MPC_SIMD_VEC(fill, vec, vec.data(), vec.size(), val);
+}
+
+template <typename T, size_t N, typename A, typename G>
+const T *find(const smallVector<T, N, A, G> &vec, T val) {
+  return MPC_SIMD_VEC(find, vec, vec.data(), vec.size(), val);
+}
+
+template <typename T, size_t N, typename A, typename G>
+size_t count(const smallVector<T, N, A, G> &vec, T val) {
+  return MPC_SIMD_VEC(count, vec, vec.data(), vec.size(), val);
+}
+
+template <typename T, size_t N, typename A, typename G>
+T sum(const smallVector<T, N, A, G> &vec) {
+  return MPC_SIMD_VEC(sum, vec, vec.data(), vec.size());
+}
+
+template <typename T, size_t N, typename A, typename G>
+T min(const smallVector<T, N, A, G> &vec) {
+  assert(!vec.empty());
+  return MPC_SIMD_VEC(min, vec, vec.data(), vec.size());
+}
+
+template <typename T, size_t N, typename A, typename G>
+T max(const smallVector<T, N, A, G> &vec) {
+  assert(!vec.empty());
+  return MPC_SIMD_VEC(max, vec, vec.data(), vec.size());
+}
+
+// src holds at least vec.size() elements
+template <typename T, size_t N, typename A, typename G>
+void add(smallVector<T, N, A, G> &vec, const T *src) {
+  MPC_SIMD_VEC(add, vec, vec.data(), src, vec.size());
+}
+
+template <typename T, size_t N, typename A, typename G>
+void mul(smallVector<T, N, A, G> &vec, const T *src) {
+  MPC_SIMD_VEC(mul, vec, vec.data(), src, vec.size());
+}
+
+#undef MPC_SIMD_VEC
+
+}  // namespace simd
+}  // namespace mpc
+
+#endif  // MPC_SIMD
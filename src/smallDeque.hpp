@@ -0,0 +1,491 @@
+#ifndef MPC_SMALLDEQUE
+#define MPC_SMALLDEQUE
+
+// Double-ended queue in a ring buffer of N inline slots, spilling to one
+// heap block. push and pop are O(1) at both ends. Growth moves the elements
+// into a new block starting at slot 0, so a grown deque is contiguous until
+// it wraps again. as_contiguous() rotates the elements into place when a
+// span is needed.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "compactVector.hpp"
+#include "smallVector.hpp"
+#include "span.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+// Random access iterator of a smallDeque, an element index into Deque
+template <typename Deque, typename V>
+class dequeIterator {
+  Deque *m_deque;
+  size_t m_ind;
+
+  template <typename, typename>
+  friend class dequeIterator;
+
+ public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename std::remove_const<V>::type value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef V *pointer;
+  typedef V &reference;
+
+  dequeIterator() noexcept : m_deque(nullptr), m_ind(0) {}
+
+  dequeIterator(Deque *deque, size_t ind) noexcept
+      : m_deque(deque), m_ind(ind) {}
+
+  // iterator to const_iterator
+  template <typename D, typename W,
+            typename = typename std::enable_if<
+                std::is_convertible<W *, V *>::value>::type>
+  dequeIterator(const dequeIterator<D, W> &other) noexcept
+      : m_deque(other.m_deque), m_ind(other.m_ind) {}
+
+  reference operator*() const { return (*m_deque)[m_ind]; }
+  pointer operator->() const { return &(*m_deque)[m_ind]; }
+  reference operator[](difference_type n) const {
+    return (*m_deque)[m_ind + n];
+  }
+
+  dequeIterator &operator++() noexcept {
+    m_ind++;
+    return *this;
+  }
+  dequeIterator operator++(int) noexcept {
+    return dequeIterator(m_deque, m_ind++);
+  }
+  dequeIterator &operator--() noexcept {
+    m_ind--;
+    return *this;
+  }
+  dequeIterator operator--(int) noexcept {
+    return dequeIterator(m_deque, m_ind--);
+  }
+  dequeIterator &operator+=(difference_type n) noexcept {
+    m_ind += n;
+    return *this;
+  }
+  dequeIterator &operator-=(difference_type n) noexcept {
+    m_ind -= n;
+    return *this;
+  }
+  dequeIterator operator+(difference_type n) const noexcept {
+    return dequeIterator(m_deque, m_ind + n);
+  }
+  friend dequeIterator operator+(difference_type n, const dequeIterator &it) {
+    return it + n;
+  }
+  dequeIterator operator-(difference_type n) const noexcept {
+    return dequeIterator(m_deque, m_ind - n);
+  }
+  difference_type operator-(const dequeIterator &other) const noexcept {
+    return difference_type(m_ind) - difference_type(other.m_ind);
+  }
+
+  bool operator==(const dequeIterator &o) const { return m_ind == o.m_ind; }
+  bool operator!=(const dequeIterator &o) const { return m_ind != o.m_ind; }
+  bool operator<(const dequeIterator &o) const { return m_ind < o.m_ind; }
+  bool operator>(const dequeIterator &o) const { return m_ind > o.m_ind; }
+  bool operator<=(const dequeIterator &o) const { return m_ind <= o.m_ind; }
+  bool operator>=(const dequeIterator &o) const { return m_ind >= o.m_ind; }
+};
+
+}  // namespace detail
+
+template <typename T, size_t N = 8, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+class smallDeque : private detail::allocHolder<Alloc>,
+                   private detail::compactBuffer<T, N> {
+  static_assert(std::is_same<typename Alloc::value_type, T>::value,
+                "Alloc::value_type must be T");
+
+  typedef detail::allocHolder<Alloc> allocBase;
+  typedef detail::compactBuffer<T, N> buffBase;
+  typedef std::allocator_traits<Alloc> allocTraits;
+
+  using buffBase::buff;
+
+  // Member variables
+  // The ring, the inline slots or the heap block
+  T *m_data;
+  size_t m_cap;
+  // Slot of the first element
+  size_t m_head;
+  size_t m_size;
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef detail::dequeIterator<smallDeque, T> iterator;
+  typedef detail::dequeIterator<const smallDeque, const T> const_iterator;
+  typedef Alloc allocator_type;
+
+  //====================Ctors and Dtors====================
+
+  smallDeque() : smallDeque(Alloc()) {}
+
+  explicit smallDeque(const Alloc &alloc)
+      : allocBase(alloc), m_data(buff()), m_cap(N), m_head(0), m_size(0) {}
+
+  // sz value-initialized elements
+  smallDeque(const size_t sz, const Alloc &alloc = Alloc())
+      : smallDeque(alloc) {
+    reserve(sz);
+    for (size_t i = 0; i < sz; i++) emplace_back();
+  }
+
+  smallDeque(const smallDeque &other)
+      : smallDeque(allocTraits::select_on_container_copy_construction(
+            other.getAllocator())) {
+    append(other.begin(), other.end());
+  }
+
+  // Range constructor
+  template <typename It, typename = detail::requireIter<It>>
+  smallDeque(It first, It last, const Alloc &alloc = Alloc())
+      : smallDeque(alloc) {
+    append(first, last);
+  }
+
+  // Steals the heap block, or moves the inline elements
+  smallDeque(smallDeque &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value)
+      : smallDeque(other.getAllocator()) {
+    takeFrom(other);
+  }
+
+  smallDeque(std::initializer_list<T> init, const Alloc &alloc = Alloc())
+      : smallDeque(alloc) {
+    append(init.begin(), init.end());
+  }
+
+  ~smallDeque() {
+    clear();
+    freeHeap();
+  }
+
+  //___________________________Operators_______________________________
+
+  // Copy op =
+  smallDeque &operator=(const smallDeque &other) {
+    if (this == &other) return *this;
+    clear();
+    if (allocTraits::propagate_on_container_copy_assignment::value &&
+        !(this->getAllocator() == other.getAllocator())) {
+      freeHeap();
+      this->getAllocator() = other.getAllocator();
+    }
+    append(other.begin(), other.end());
+    return *this;
+  }
+
+  // Move op =, unequal allocators that do not propagate move the elements
+  smallDeque &operator=(smallDeque &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value &&
+      (allocTraits::propagate_on_container_move_assignment::value ||
+       detail::allocAlwaysEqual<Alloc>::value)) {
+    if (this == &other) return *this;
+    clear();
+    if (allocTraits::propagate_on_container_move_assignment::value ||
+        this->getAllocator() == other.getAllocator()) {
+      freeHeap();
+      this->getAllocator() = std::move(other.getAllocator());
+      takeFrom(other);
+    } else {
+      append(std::make_move_iterator(other.begin()),
+             std::make_move_iterator(other.end()));
+      other.clear();
+    }
+    return *this;
+  }
+
+  smallDeque &operator=(std::initializer_list<T> init) {
+    clear();
+    append(init.begin(), init.end());
+    return *this;
+  }
+
+  reference operator[](size_t ind) { return m_data[slot(ind)]; }
+
+  const_reference operator[](size_t ind) const { return m_data[slot(ind)]; }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  void push_back(const T &inp) { emplace_back(inp); }
+
+  void push_back(T &&inp) { emplace_back(std::move(inp)); }
+
+  template <typename... Ts>
+  reference emplace_back(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(m_size == m_cap))
+      return growAndEmplace(m_size, std::forward<Ts>(params)...);
+    T *res = new (m_data + slot(m_size)) T(std::forward<Ts>(params)...);
+    m_size++;
+    return *res;
+  }
+
+  void push_front(const T &inp) { emplace_front(inp); }
+
+  void push_front(T &&inp) { emplace_front(std::move(inp)); }
+
+  template <typename... Ts>
+  reference emplace_front(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(m_size == m_cap))
+      return growAndEmplace(0, std::forward<Ts>(params)...);
+    size_t head = m_head ? m_head - 1 : m_cap - 1;
+    T *res = new (m_data + head) T(std::forward<Ts>(params)...);
+    m_head = head;
+    m_size++;
+    return *res;
+  }
+
+  // Appends [first, last), reserving once for forward ranges.
+  // The range must not point into this deque.
+  template <typename It, typename = detail::requireIter<It>>
+  void append(It first, It last) {
+    appendRange(first, last,
+                typename std::iterator_traits<It>::iterator_category());
+  }
+
+  void pop_back() noexcept {
+    assert(!empty());
+    m_data[slot(m_size - 1)].~T();
+    m_size--;
+  }
+
+  void pop_front() noexcept {
+    assert(!empty());
+    m_data[m_head].~T();
+    m_head = m_head + 1 == m_cap ? 0 : m_head + 1;
+    m_size--;
+  }
+
+  // Destructs the elements, capacity is kept
+  void clear() noexcept {
+    if (!std::is_trivially_destructible<T>::value)
+      for (size_t i = 0; i < m_size; i++) m_data[slot(i)].~T();
+    m_head = 0;
+    m_size = 0;
+  }
+
+  // Reserves at least inp slots, the elements end up contiguous from
+  // slot 0. Strong exc. guar.
+  void reserve(size_t inp) {
+    if (inp > m_cap) moveTo(inp);
+  }
+
+  // Rotates the elements to start at slot 0 and returns them. No
+  // allocation, O(size) moves when the ring wraps or starts elsewhere.
+  // The moves of T must not throw.
+  span<T> as_contiguous() {
+    if (m_head + m_size > m_cap) {
+      // Wrapped: close the gap, then rotate the two runs into order.
+      // [0, tail) and [m_head, m_cap) hold elements, [tail, m_head) is raw.
+      size_t tail = m_head + m_size - m_cap;
+      size_t gap = m_head - tail;
+      for (size_t i = m_head; gap && i < m_cap; i++) {
+        new (m_data + i - gap) T(std::move(m_data[i]));
+        m_data[i].~T();
+      }
+      std::rotate(m_data, m_data + tail, m_data + m_size);
+    } else if (m_head) {
+      for (size_t i = 0; i < m_size; i++) {
+        new (m_data + i) T(std::move(m_data[m_head + i]));
+        m_data[m_head + i].~T();
+      }
+    }
+    m_head = 0;
+    return span<T>(m_data, m_size);
+  }
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() noexcept { return iterator(this, 0); }
+
+  const_iterator begin() const noexcept { return const_iterator(this, 0); }
+
+  iterator end() noexcept { return iterator(this, m_size); }
+
+  const_iterator end() const noexcept { return const_iterator(this, m_size); }
+
+  //___________________________Getters_______________________________
+
+  size_t size() const noexcept { return m_size; }
+
+  bool empty() const noexcept { return m_size == 0; }
+
+  size_t capacity() const noexcept { return m_cap; }
+
+  reference front() { return m_data[m_head]; }
+
+  const_reference front() const { return m_data[m_head]; }
+
+  reference back() { return m_data[slot(m_size - 1)]; }
+
+  const_reference back() const { return m_data[slot(m_size - 1)]; }
+
+  allocator_type get_allocator() const { return this->getAllocator(); }
+
+  // Heap capacity, 0 while inline
+  size_t getAlloc() const noexcept { return onHeap() ? m_cap : 0; }
+
+  static constexpr size_t inlineCapacity() noexcept { return N; }
+
+  //___________________________Misc_______________________________
+
+  // Heap blocks are swapped, inline elements are moved
+  void swap(smallDeque &other) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
+    if (this == &other) return;
+    smallDeque temp(std::move(other));
+    other.takeFrom(*this);
+    takeFrom(temp);
+    using std::swap;
+    swap(this->getAllocator(), other.getAllocator());
+  }
+
+  //___________________________Private func_______________________________
+
+ private:
+  bool onHeap() const noexcept { return m_data != buff(); }
+
+  // Slot of element ind, ind <= m_cap
+  size_t slot(size_t ind) const noexcept {
+    size_t s = m_head + ind;
+    return s >= m_cap ? s - m_cap : s;
+  }
+
+  void freeHeap() noexcept {
+    if (!onHeap()) return;
+    Alloc &alloc = this->getAllocator();
+    allocTraits::deallocate(alloc, m_data, m_cap);
+    m_data = buff();
+    m_cap = N;
+    m_head = 0;
+  }
+
+  // Moves element i of [0, m_size) to slot i + offset of dest, in order
+  void relocateInto(T *dest, size_t offset) {
+    size_t first = std::min(m_size, m_cap - m_head);
+    detail::relocateRange(m_data + m_head, m_data + m_head + first,
+                          dest + offset);
+    MPC_SV_TRY {
+      detail::relocateRange(m_data, m_data + (m_size - first),
+                            dest + offset + first);
+    }
+    MPC_SV_CATCH_ALL {
+      // Put the first run back so the deque stays whole
+      detail::relocateRange(dest + offset, dest + offset + first,
+                            m_data + m_head);
+      MPC_SV_RETHROW;
+    }
+  }
+
+  // New block of cap slots holding the elements from offset on
+  // Strong exc. guar.
+  void moveTo(size_t cap, size_t offset = 0) {
+    Alloc &alloc = this->getAllocator();
+    T *block = allocTraits::allocate(alloc, cap);
+    MPC_SV_TRY { relocateInto(block, offset); }
+    MPC_SV_CATCH_ALL {
+      allocTraits::deallocate(alloc, block, cap);
+      MPC_SV_RETHROW;
+    }
+    freeHeap();
+    m_data = block;
+    m_cap = cap;
+    m_head = offset;
+  }
+
+  size_t nextCapacity(size_t chckSize) const noexcept {
+    return std::max(Growth::next(m_cap, chckSize, sizeof(T)), chckSize);
+  }
+
+  // Cold half of emplace_back and emplace_front, the new element goes to
+  // index ind (0 or m_size). The elements move after it is built, so
+  // params may refer to one of them.
+  template <typename... Ts>
+  MPC_SV_COLD reference growAndEmplace(size_t ind, Ts &&...params) {
+    size_t cap = nextCapacity(m_size + 1);
+    Alloc &alloc = this->getAllocator();
+    T *block = allocTraits::allocate(alloc, cap);
+    T *res = block + (ind ? ind : cap - 1);
+    MPC_SV_TRY { new (res) T(std::forward<Ts>(params)...); }
+    MPC_SV_CATCH_ALL {
+      allocTraits::deallocate(alloc, block, cap);
+      MPC_SV_RETHROW;
+    }
+    MPC_SV_TRY { relocateInto(block, 0); }
+    MPC_SV_CATCH_ALL {
+      res->~T();
+      allocTraits::deallocate(alloc, block, cap);
+      MPC_SV_RETHROW;
+    }
+    size_t size = m_size;
+    freeHeap();
+    m_data = block;
+    m_cap = cap;
+    m_head = ind ? 0 : cap - 1;
+    m_size = size + 1;
+    return *res;
+  }
+
+  template <typename It>
+  void appendRange(It first, It last, std::input_iterator_tag) {
+    for (; first != last; ++first) emplace_back(*first);
+  }
+
+  template <typename It>
+  void appendRange(It first, It last, std::forward_iterator_tag) {
+    size_t n = std::distance(first, last);
+    if (m_size + n > m_cap) reserve(nextCapacity(m_size + n));
+    for (; first != last; ++first) emplace_back(*first);
+  }
+
+  // Takes other's heap block or moves its inline elements, this is empty
+  // and inline
+  void takeFrom(smallDeque &other) {
+    if (other.onHeap()) {
+      m_data = other.m_data;
+      m_cap = other.m_cap;
+      m_head = other.m_head;
+      m_size = other.m_size;
+      other.m_data = other.buff();
+      other.m_cap = N;
+    } else {
+      other.relocateInto(buff(), 0);
+      m_size = other.m_size;
+    }
+    other.m_head = 0;
+    other.m_size = 0;
+  }
+};
+
+// outside swap function
+template <typename T, size_t N, typename Alloc, typename Growth>
+void swap(smallDeque<T, N, Alloc, Growth> &adeq,
+          smallDeque<T, N, Alloc, Growth> &bdeq) noexcept(
+    noexcept(adeq.swap(bdeq))) {
+  adeq.swap(bdeq);
+}
+
+}  // namespace mpc
+
+#endif  // MPC_SMALLDEQUE
@@ -0,0 +1,141 @@
+#ifndef MPC_SMALLFLATMAP
+#define MPC_SMALLFLATMAP
+
+// Sorted map of std::pair<K, V> in a smallVector, see smallFlatSet for the
+// lookup strategy. Keys are not const in the stored pairs as the values
+// shift on insertion, changing a key through an iterator breaks the order.
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <tuple>
+#include <utility>
+
+#include "smallFlatSet.hpp"
+
+namespace mpc {
+
+template <typename K, typename V, size_t N = 8, typename Compare = std::less<K>,
+          size_t HashAfter = 0, typename Hash = std::hash<K>>
+class smallFlatMap
+    : public detail::flatTree<std::pair<K, V>, K, detail::firstKey, N, Compare,
+                              HashAfter, Hash> {
+  typedef detail::flatTree<std::pair<K, V>, K, detail::firstKey, N, Compare,
+                           HashAfter, Hash>
+      tree;
+
+ public:
+  // Public member types
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K, V> value_type;
+  typedef value_type *iterator;
+  typedef const value_type *const_iterator;
+
+  //====================Ctors====================
+
+  smallFlatMap() = default;
+
+  explicit smallFlatMap(const Compare &comp) : tree(comp) {}
+
+  // Unsorted range, sorted and deduplicated once, the first of equal keys
+  // is kept
+  template <typename It, typename = detail::requireIter<It>>
+  smallFlatMap(It first, It last, const Compare &comp = Compare())
+      : tree(first, last, comp) {}
+
+  smallFlatMap(std::initializer_list<value_type> init,
+               const Compare &comp = Compare())
+      : tree(init.begin(), init.end(), comp) {}
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  using tree::insert;
+
+  std::pair<iterator, bool> insert(const value_type &val) {
+    return this->insertValue(val);
+  }
+
+  std::pair<iterator, bool> insert(value_type &&val) {
+    return this->insertValue(std::move(val));
+  }
+
+  template <typename... Ts>
+  std::pair<iterator, bool> emplace(Ts &&...params) {
+    return this->insertValue(value_type(std::forward<Ts>(params)...));
+  }
+
+  // Inserts {key, V(params...)} unless key is present. Goes by position,
+  // not find(), which would build the hash index only to drop it.
+  template <typename... Ts>
+  std::pair<iterator, bool> try_emplace(const K &key, Ts &&...params) {
+    size_t i = this->lowerIndex(key);
+    if (i < this->size() && !this->m_comp(key, this->m_vec[i].first))
+      return std::make_pair(begin() + i, false);
+    return std::make_pair(
+        this->insertAt(i, value_type(std::piecewise_construct,
+                                     std::forward_as_tuple(key),
+                                     std::forward_as_tuple(
+                                         std::forward<Ts>(params)...))),
+        true);
+  }
+
+  template <typename M>
+  std::pair<iterator, bool> insert_or_assign(const K &key, M &&val) {
+    std::pair<iterator, bool> res = try_emplace(key, std::forward<M>(val));
+    if (!res.second) res.first->second = std::forward<M>(val);
+    return res;
+  }
+
+  // Value of key, value-initialized when key is new
+  V &operator[](const K &key) { return try_emplace(key).first->second; }
+
+  // Reports an error through MPC_SV_ERROR_POLICY when key is missing
+  template <typename L, typename = detail::requireLookup<Compare, K, L>>
+  V &at(const L &key) {
+    iterator it = find(key);
+    if (it == end()) detail::throwOutOfRange("smallFlatMap::at");
+    return it->second;
+  }
+
+  template <typename L, typename = detail::requireLookup<Compare, K, L>>
+  const V &at(const L &key) const {
+    const_iterator it = find(key);
+    if (it == end()) detail::throwOutOfRange("smallFlatMap::at");
+    return it->second;
+  }
+
+  //___________________________Lookup_______________________________
+
+  template <typename L, typename = detail::requireLookup<Compare, K, L>>
+  iterator find(const L &key) {
+    return this->mutableAt(tree::find(key));
+  }
+
+  template <typename L, typename = detail::requireLookup<Compare, K, L>>
+  const_iterator find(const L &key) const {
+    return tree::find(key);
+  }
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() noexcept { return this->m_vec.begin(); }
+
+  const_iterator begin() const noexcept { return this->m_vec.begin(); }
+
+  iterator end() noexcept { return this->m_vec.end(); }
+
+  const_iterator end() const noexcept { return this->m_vec.end(); }
+};
+
+template <typename K, typename V, size_t N, typename Compare,
+          size_t HashAfter, typename Hash, typename Pred>
+size_t erase_if(smallFlatMap<K, V, N, Compare, HashAfter, Hash> &map,
+                Pred pred) {
+  return map.eraseIf(pred);
+}
+
+}  // namespace mpc
+
+#endif  // MPC_SMALLFLATMAP
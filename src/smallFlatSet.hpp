@@ -0,0 +1,387 @@
+#ifndef MPC_SMALLFLATSET
+#define MPC_SMALLFLATSET
+
+// Sorted set in a smallVector: no node allocations, and no allocation at
+// all up to N elements. Lookups scan linearly while inline and binary
+// search once spilled. With HashAfter > 0, sets of at least HashAfter
+// elements also build a hash index over the elements on the first lookup
+// after a change. Compare::is_transparent enables heterogeneous lookup.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+#include "smallVector.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+template <typename Compare, typename K, typename = void>
+struct isTransparent : std::false_type {};
+
+template <typename Compare, typename K>
+struct isTransparent<Compare, K,
+                     typename voidType<typename Compare::is_transparent>::type>
+    : std::true_type {};
+
+// Lookup key K for a tree with key Key and comparator Compare
+template <typename Compare, typename Key, typename K>
+using requireLookup = typename std::enable_if<
+    std::is_same<K, Key>::value || isTransparent<Compare, K>::value>::type;
+
+struct identityKey {
+  template <typename T>
+  const T &operator()(const T &val) const noexcept {
+    return val;
+  }
+};
+
+struct firstKey {
+  template <typename P>
+  const typename P::first_type &operator()(const P &val) const noexcept {
+    return val.first;
+  }
+};
+
+// Open addressing table of element positions + 1, 0 is empty
+template <bool Enabled>
+struct flatIndex {
+  mutable smallVector<uint32_t, 0> m_slots;
+  mutable bool m_valid = false;
+};
+
+template <>
+struct flatIndex<false> {};
+
+// Sorted unique Values in a smallVector, shared by smallFlatSet and
+// smallFlatMap. KeyOf gives the key of a value.
+template <typename Value, typename Key, typename KeyOf, size_t N,
+          typename Compare, size_t HashAfter, typename Hash>
+class flatTree : private flatIndex<HashAfter != 0> {
+  typedef std::integral_constant<bool, HashAfter != 0> hashed;
+
+ protected:
+  // Member variables
+  smallVector<Value, N> m_vec;
+  Compare m_comp;
+
+ public:
+  // Public member types
+  typedef Key key_type;
+  typedef Value value_type;
+  typedef Compare key_compare;
+  typedef size_t size_type;
+
+  //====================Ctors====================
+
+  flatTree() = default;
+
+  explicit flatTree(const Compare &comp) : m_comp(comp) {}
+
+  // One sort and one dedup, the first of equal keys is kept
+  template <typename It, typename = requireIter<It>>
+  flatTree(It first, It last, const Compare &comp = Compare()) : m_comp(comp) {
+    m_vec.append(first, last);
+    sortUnique(0);
+  }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  // Inserts [first, last): the new values are sorted on their own, merged
+  // and deduplicated, values already present win
+  template <typename It, typename = requireIter<It>>
+  void insert(It first, It last) {
+    size_t old = m_vec.size();
+    m_vec.append(first, last);
+    sortUnique(old);
+  }
+
+  void insert(std::initializer_list<Value> init) {
+    insert(init.begin(), init.end());
+  }
+
+  // Erases the value with key, returns how many were erased
+  template <typename K, typename = requireLookup<Compare, Key, K>>
+  size_t erase(const K &key) {
+    const Value *it = find(key);
+    if (it == end()) return 0;
+    erase(it);
+    return 1;
+  }
+
+  const Value *erase(const Value *pos) {
+    invalidate(hashed());
+    return m_vec.erase(pos);
+  }
+
+  const Value *erase(const Value *first, const Value *last) {
+    invalidate(hashed());
+    return m_vec.erase(first, last);
+  }
+
+  void clear() noexcept {
+    invalidate(hashed());
+    m_vec.clear();
+  }
+
+  // Erases every value matching pred, returns how many were erased
+  template <typename Pred>
+  size_t eraseIf(Pred pred) {
+    invalidate(hashed());
+    size_t old = m_vec.size();
+    m_vec.erase(std::remove_if(m_vec.begin(), m_vec.end(), pred),
+                m_vec.end());
+    return old - m_vec.size();
+  }
+
+  void reserve(size_t inp) { m_vec.reserve(inp); }
+
+  void shrink_to_fit() { m_vec.shrink_to_fit(); }
+
+  void swap(flatTree &other) {
+    invalidate(hashed());
+    other.invalidate(hashed());
+    m_vec.swap(other.m_vec);
+    std::swap(m_comp, other.m_comp);
+  }
+
+  //___________________________Lookup_______________________________
+
+  template <typename K, typename = requireLookup<Compare, Key, K>>
+  const Value *find(const K &key) const {
+    return findIndex(key, std::integral_constant<
+                              bool, hashed::value &&
+                                        std::is_same<K, Key>::value>());
+  }
+
+  template <typename K, typename = requireLookup<Compare, Key, K>>
+  size_t count(const K &key) const {
+    return find(key) != end();
+  }
+
+  template <typename K, typename = requireLookup<Compare, Key, K>>
+  bool contains(const K &key) const {
+    return find(key) != end();
+  }
+
+  // First value whose key is not less than key
+  template <typename K, typename = requireLookup<Compare, Key, K>>
+  const Value *lower_bound(const K &key) const {
+    return begin() + lowerIndex(key);
+  }
+
+  // First value whose key is greater than key
+  template <typename K, typename = requireLookup<Compare, Key, K>>
+  const Value *upper_bound(const K &key) const {
+    const Value *it = lower_bound(key);
+    return it != end() && !m_comp(key, KeyOf()(*it)) ? it + 1 : it;
+  }
+
+  //___________________________Getters_______________________________
+
+  const Value *begin() const noexcept { return m_vec.begin(); }
+
+  const Value *end() const noexcept { return m_vec.end(); }
+
+  size_t size() const noexcept { return m_vec.size(); }
+
+  bool empty() const noexcept { return m_vec.empty(); }
+
+  size_t capacity() const noexcept { return m_vec.capacity(); }
+
+  key_compare key_comp() const { return m_comp; }
+
+  // The sorted values
+  const smallVector<Value, N> &sequence() const noexcept { return m_vec; }
+
+  //___________________________Private func_______________________________
+
+ protected:
+  template <typename K>
+  size_t lowerIndex(const K &key) const {
+    const Value *data = m_vec.data();
+    size_t n = m_vec.size();
+    // A linear scan beats binary search over a few inline values
+    if (!m_vec.getAlloc()) {
+      size_t i = 0;
+      while (i < n && m_comp(KeyOf()(data[i]), key)) i++;
+      return i;
+    }
+    const Compare &comp = m_comp;
+    return std::lower_bound(data, data + n, key,
+                            [&comp](const Value &val, const K &k) {
+                              return comp(KeyOf()(val), k);
+                            }) -
+           data;
+  }
+
+  bool equalKeys(const Key &a, const Key &b) const {
+    return !m_comp(a, b) && !m_comp(b, a);
+  }
+
+  // Inserts val unless its key is present
+  template <typename V>
+  std::pair<Value *, bool> insertValue(V &&val) {
+    size_t i = lowerIndex(KeyOf()(val));
+    if (i < size() && !m_comp(KeyOf()(val), KeyOf()(m_vec[i])))
+      return std::make_pair(m_vec.data() + i, false);
+    return std::make_pair(insertAt(i, std::forward<V>(val)), true);
+  }
+
+  // Inserts val at position i, which lowerIndex gave for its key
+  template <typename V>
+  Value *insertAt(size_t i, V &&val) {
+    Value *it = m_vec.insert(m_vec.begin() + i, std::forward<V>(val));
+    indexInserted(i, hashed());
+    return it;
+  }
+
+  Value *mutableAt(const Value *pos) noexcept {
+    return m_vec.data() + (pos - m_vec.data());
+  }
+
+  // Values past sorted are new: sort them stably, merge and keep the first
+  // of equal keys
+  void sortUnique(size_t sorted) {
+    invalidate(hashed());
+    const Compare &comp = m_comp;
+    auto less = [&comp](const Value &a, const Value &b) {
+      return comp(KeyOf()(a), KeyOf()(b));
+    };
+    Value *data = m_vec.data();
+    if (!m_vec.getAlloc()) {
+      // A few inline values: insertion sort, stable_sort and inplace_merge
+      // would take a temporary buffer from the heap
+      for (size_t i = sorted; i < m_vec.size(); i++)
+        std::rotate(std::upper_bound(data, data + i, data[i], less), data + i,
+                    data + i + 1);
+    } else {
+      std::stable_sort(data + sorted, data + m_vec.size(), less);
+      std::inplace_merge(data, data + sorted, data + m_vec.size(), less);
+    }
+    Value *last =
+        std::unique(data, data + m_vec.size(),
+                    [&less](const Value &a, const Value &b) {
+                      return !less(a, b) && !less(b, a);
+                    });
+    m_vec.erase(last, m_vec.end());
+  }
+
+  void invalidate(std::false_type) const noexcept {}
+
+  void invalidate(std::true_type) const noexcept { this->m_valid = false; }
+
+  void indexInserted(size_t, std::false_type) const noexcept {}
+
+  // A valid index is updated in place: the positions after i move up by
+  // one and i gets a slot. It is only dropped when it would be more than
+  // half full, the next lookup rebuilds it twice as large.
+  void indexInserted(size_t i, std::true_type) const {
+    if (!this->m_valid) return;
+    smallVector<uint32_t, 0> &slots = this->m_slots;
+    if (2 * size() > slots.size()) return invalidate(hashed());
+    for (uint32_t &pos : slots)
+      if (pos > i) pos++;
+    size_t mask = slots.size() - 1;
+    size_t s = Hash()(KeyOf()(m_vec[i])) & mask;
+    while (slots[s]) s = (s + 1) & mask;
+    slots[s] = static_cast<uint32_t>(i + 1);
+  }
+
+  template <typename K>
+  const Value *findIndex(const K &key, std::false_type) const {
+    size_t i = lowerIndex(key);
+    if (i < size() && !m_comp(key, KeyOf()(m_vec[i]))) return begin() + i;
+    return end();
+  }
+
+  const Value *findIndex(const Key &key, std::true_type) const {
+    if (size() < HashAfter) return findIndex(key, std::false_type());
+    if (!this->m_valid) buildIndex();
+    const smallVector<uint32_t, 0> &slots = this->m_slots;
+    size_t mask = slots.size() - 1;
+    for (size_t s = Hash()(key) & mask;; s = (s + 1) & mask) {
+      uint32_t pos = slots[s];
+      if (!pos) return end();
+      if (equalKeys(KeyOf()(m_vec[pos - 1]), key)) return begin() + pos - 1;
+    }
+  }
+
+  // Power of two table at most half full
+  void buildIndex() const {
+    size_t cap = 4;
+    while (cap < 2 * size()) cap *= 2;
+    smallVector<uint32_t, 0> &slots = this->m_slots;
+    slots.assign(cap, 0);
+    for (size_t i = 0; i < size(); i++) {
+      size_t s = Hash()(KeyOf()(m_vec[i])) & (cap - 1);
+      while (slots[s]) s = (s + 1) & (cap - 1);
+      slots[s] = static_cast<uint32_t>(i + 1);
+    }
+    this->m_valid = true;
+  }
+};
+
+}  // namespace detail
+
+template <typename T, size_t N = 8, typename Compare = std::less<T>,
+          size_t HashAfter = 0, typename Hash = std::hash<T>>
+class smallFlatSet : public detail::flatTree<T, T, detail::identityKey, N,
+                                             Compare, HashAfter, Hash> {
+  typedef detail::flatTree<T, T, detail::identityKey, N, Compare, HashAfter,
+                           Hash>
+      tree;
+
+ public:
+  typedef const T *iterator;
+  typedef const T *const_iterator;
+
+  //====================Ctors====================
+
+  smallFlatSet() = default;
+
+  explicit smallFlatSet(const Compare &comp) : tree(comp) {}
+
+  // Unsorted range, sorted and deduplicated once
+  template <typename It, typename = detail::requireIter<It>>
+  smallFlatSet(It first, It last, const Compare &comp = Compare())
+      : tree(first, last, comp) {}
+
+  smallFlatSet(std::initializer_list<T> init, const Compare &comp = Compare())
+      : tree(init.begin(), init.end(), comp) {}
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  using tree::insert;
+
+  std::pair<iterator, bool> insert(const T &val) {
+    return this->insertValue(val);
+  }
+
+  std::pair<iterator, bool> insert(T &&val) {
+    return this->insertValue(std::move(val));
+  }
+
+  template <typename... Ts>
+  std::pair<iterator, bool> emplace(Ts &&...params) {
+    return this->insertValue(T(std::forward<Ts>(params)...));
+  }
+};
+
+template <typename T, size_t N, typename Compare, size_t HashAfter,
+          typename Hash, typename Pred>
+size_t erase_if(smallFlatSet<T, N, Compare, HashAfter, Hash> &set, Pred pred) {
+  return set.eraseIf(pred);
+}
+
+}  // namespace mpc
+
+#endif  // MPC_SMALLFLATSET
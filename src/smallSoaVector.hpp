@@ -0,0 +1,575 @@
+#ifndef MPC_SMALLSOAVECTOR
+#define MPC_SMALLSOAVECTOR
+
+// Structure of arrays companion of smallVector: smallSoaVector<std::tuple<
+// A, B, C>, N> keeps every field in its own contiguous column, so a scan over
+// one field touches only that field's cache lines. All columns share one
+// inline buffer for N rows, or one heap block past that.
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "compactVector.hpp"
+#include "smallVector.hpp"
+#include "span.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+// std::index_sequence for C++11
+template <size_t... Is>
+struct indexSeq {};
+
+template <size_t K, size_t... Is>
+struct makeIndexSeq : makeIndexSeq<K - 1, K - 1, Is...> {};
+
+template <size_t... Is>
+struct makeIndexSeq<0, Is...> {
+  typedef indexSeq<Is...> type;
+};
+
+template <size_t I>
+using colTag = std::integral_constant<size_t, I>;
+
+constexpr size_t roundUp(size_t v, size_t align) {
+  return (v + align - 1) / align * align;
+}
+
+template <typename... Ts>
+struct maxAlign;
+
+template <>
+struct maxAlign<> : std::integral_constant<size_t, 1> {};
+
+template <typename T, typename... Ts>
+struct maxAlign<T, Ts...>
+    : std::integral_constant<size_t, (alignof(T) > maxAlign<Ts...>::value)
+                                         ? alignof(T)
+                                         : maxAlign<Ts...>::value> {};
+
+// Column I of a block holding cap rows starts at offset(I, cap)
+template <typename... Ts>
+struct soaLayout {
+  static const size_t K = sizeof...(Ts);
+
+  template <size_t I>
+  using col = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+  static constexpr size_t offset(colTag<0>, size_t) { return 0; }
+
+  template <size_t I>
+  static constexpr size_t offset(colTag<I>, size_t cap) {
+    return roundUp(offset(colTag<I - 1>(), cap) + sizeof(col<I - 1>) * cap,
+                   alignof(col<I>));
+  }
+
+  static constexpr size_t blockBytes(size_t cap) {
+    return offset(colTag<K - 1>(), cap) + sizeof(col<K - 1>) * cap;
+  }
+};
+
+}  // namespace detail
+
+template <typename Tuple, size_t N = 8, typename Alloc = std::allocator<char>,
+          typename Growth = growDouble>
+class smallSoaVector;
+
+template <typename... Ts, size_t N, typename Alloc, typename Growth>
+class smallSoaVector<std::tuple<Ts...>, N, Alloc, Growth>
+    : private detail::allocHolder<
+          typename std::allocator_traits<Alloc>::template rebind_alloc<
+              detail::compactUnit<detail::maxAlign<Ts...>::value>>> {
+  static const size_t K = sizeof...(Ts);
+  static_assert(K > 0, "at least one column");
+  static_assert(N <= UINT32_MAX, "inline capacity must fit in 32 bits");
+  static_assert(detail::maxAlign<Ts...>::value <= alignof(std::max_align_t),
+                "over-aligned columns are not supported");
+
+  // The block is allocated in units aligned for every column, an allocator
+  // of char would only guarantee alignof(char)
+  typedef detail::compactUnit<detail::maxAlign<Ts...>::value> unit;
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<unit>
+      unitAlloc;
+  typedef detail::allocHolder<unitAlloc> allocBase;
+  typedef std::allocator_traits<unitAlloc> allocTraits;
+  typedef typename detail::makeIndexSeq<K>::type columns;
+
+  typedef detail::soaLayout<Ts...> layout;
+
+  template <size_t I>
+  using col = typename layout::template col<I>;
+
+  static size_t blockBytes(size_t cap) { return layout::blockBytes(cap); }
+
+  static size_t unitsFor(size_t cap) {
+    return (blockBytes(cap) + sizeof(unit) - 1) / sizeof(unit);
+  }
+
+  static const size_t inlineBytes =
+      layout::blockBytes(N) ? layout::blockBytes(N) : 1;
+
+  typedef std::tuple<Ts &...> rowRef;
+  typedef std::tuple<const Ts &...> constRowRef;
+
+  // Member variables
+  // m_data is nullptr while the rows live in m_buff, m_alloc is the
+  // capacity in rows (N while inline)
+  char *m_data;
+  uint32_t m_size;
+  uint32_t m_alloc;
+  alignas(detail::maxAlign<Ts...>::value) char m_buff[inlineBytes];
+
+ public:
+  // Public member types
+  typedef std::tuple<Ts...> value_type;
+  typedef rowRef reference;
+  typedef constRowRef const_reference;
+  typedef Alloc allocator_type;
+
+  // Random access iterator over rows whose reference is a tuple of
+  // references to the fields
+  template <bool Const>
+  class rowIterator {
+    typedef typename std::conditional<Const, const smallSoaVector,
+                                      smallSoaVector>::type vec;
+    vec *m_vec;
+    size_t m_ind;
+
+   public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef std::tuple<Ts...> value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef typename std::conditional<Const, constRowRef, rowRef>::type
+        reference;
+    typedef void pointer;
+
+    rowIterator() : m_vec(nullptr), m_ind(0) {}
+    rowIterator(vec *v, size_t ind) : m_vec(v), m_ind(ind) {}
+    operator rowIterator<true>() const { return {m_vec, m_ind}; }
+
+    reference operator*() const { return (*m_vec)[m_ind]; }
+    reference operator[](difference_type d) const {
+      return (*m_vec)[m_ind + d];
+    }
+    size_t index() const { return m_ind; }
+
+    rowIterator &operator++() {
+      ++m_ind;
+      return *this;
+    }
+    rowIterator operator++(int) { return rowIterator(m_vec, m_ind++); }
+    rowIterator &operator--() {
+      --m_ind;
+      return *this;
+    }
+    rowIterator operator--(int) { return rowIterator(m_vec, m_ind--); }
+    rowIterator &operator+=(difference_type d) {
+      m_ind += d;
+      return *this;
+    }
+    rowIterator &operator-=(difference_type d) {
+      m_ind -= d;
+      return *this;
+    }
+    rowIterator operator+(difference_type d) const {
+      return rowIterator(m_vec, m_ind + d);
+    }
+    rowIterator operator-(difference_type d) const {
+      return rowIterator(m_vec, m_ind - d);
+    }
+    difference_type operator-(const rowIterator &o) const {
+      return difference_type(m_ind) - difference_type(o.m_ind);
+    }
+    bool operator==(const rowIterator &o) const { return m_ind == o.m_ind; }
+    bool operator!=(const rowIterator &o) const { return m_ind != o.m_ind; }
+    bool operator<(const rowIterator &o) const { return m_ind < o.m_ind; }
+    bool operator>(const rowIterator &o) const { return m_ind > o.m_ind; }
+    bool operator<=(const rowIterator &o) const { return m_ind <= o.m_ind; }
+    bool operator>=(const rowIterator &o) const { return m_ind >= o.m_ind; }
+  };
+
+  typedef rowIterator<false> iterator;
+  typedef rowIterator<true> const_iterator;
+
+  //====================Ctors and Dtors====================
+
+  smallSoaVector() : smallSoaVector(Alloc()) {}
+
+  explicit smallSoaVector(const Alloc &alloc)
+      : allocBase(unitAlloc(alloc)), m_data(nullptr), m_size(0), m_alloc(N) {}
+
+  smallSoaVector(const smallSoaVector &other)
+      : smallSoaVector(Alloc(allocTraits::select_on_container_copy_construction(
+            other.getAllocator()))) {
+    appendRows(other, std::false_type());
+  }
+
+  smallSoaVector(smallSoaVector &&other) noexcept(
+      std::is_nothrow_move_constructible<std::tuple<Ts...>>::value)
+      : smallSoaVector(Alloc(other.getAllocator())) {
+    takeFrom(other);
+  }
+
+  ~smallSoaVector() {
+    clear();
+    freeHeap();
+  }
+
+  //___________________________Operators_______________________________
+
+  // Copy op =, keeps the heap block when it is big enough
+  smallSoaVector &operator=(const smallSoaVector &other) {
+    if (this == &other) return *this;
+    clear();
+    if (allocTraits::propagate_on_container_copy_assignment::value) {
+      if (!(getAllocator() == other.getAllocator())) dropHeap();
+      getAllocator() = other.getAllocator();
+    }
+    appendRows(other, std::false_type());
+    return *this;
+  }
+
+  // Move op =, unequal allocators that do not propagate move the rows
+  smallSoaVector &operator=(smallSoaVector &&other) noexcept(
+      std::is_nothrow_move_constructible<std::tuple<Ts...>>::value &&
+      (allocTraits::propagate_on_container_move_assignment::value ||
+       detail::allocAlwaysEqual<unitAlloc>::value)) {
+    if (this == &other) return *this;
+    clear();
+    if (allocTraits::propagate_on_container_move_assignment::value ||
+        getAllocator() == other.getAllocator()) {
+      dropHeap();
+      if (allocTraits::propagate_on_container_move_assignment::value)
+        getAllocator() = std::move(other.getAllocator());
+      takeFrom(other);
+    } else {
+      appendRows(other, std::true_type());
+      other.clear();
+    }
+    return *this;
+  }
+
+  // Row ind as references to its fields
+  reference operator[](size_t ind) { return row(ind, columns()); }
+
+  const_reference operator[](size_t ind) const { return row(ind, columns()); }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  // One argument per column, growth is kept out of line
+  template <typename... Us>
+  void emplace_back(Us &&...vals) {
+    static_assert(sizeof...(Us) == K, "one value per column");
+    if (MPC_SV_UNLIKELY(m_size == m_alloc))
+      return growAndEmplace(std::forward<Us>(vals)...);
+    constructRow<0>(m_size, std::forward<Us>(vals)...);
+    m_size++;
+  }
+
+  void push_back(const value_type &row) { pushTuple(row, columns()); }
+
+  void push_back(value_type &&row) { pushTuple(std::move(row), columns()); }
+
+  void pop_back() noexcept {
+    assert(m_size);
+    truncate(m_size - 1);
+  }
+
+  // O(1) erase that moves the last row into ind, order is not kept
+  void unordered_erase(size_t ind) {
+    assert(ind < m_size);
+    if (ind != m_size - 1) moveRow(ind, m_size - 1, detail::colTag<0>());
+    pop_back();
+  }
+
+  // Strong exc. guar.
+  void reserve(size_t inp) {
+    if (inp <= m_alloc) return;
+    if (inp > UINT32_MAX) detail::throwLengthError("smallSoaVector::reserve");
+    unit *units = allocTraits::allocate(getAllocator(), unitsFor(inp));
+    char *block = reinterpret_cast<char *>(units);
+    MPC_SV_TRY {
+      constructColumns(*this, block, inp, std::true_type(),
+                       detail::colTag<0>());
+    }
+    MPC_SV_CATCH_ALL {
+      allocTraits::deallocate(getAllocator(), units, unitsFor(inp));
+      MPC_SV_RETHROW;
+    }
+    destroyRows(0, m_size, detail::colTag<0>());
+    freeHeap();
+    m_data = block;
+    m_alloc = static_cast<uint32_t>(inp);
+  }
+
+  // New rows are value-initialized
+  void resize(size_t size) {
+    if (size <= m_size) return truncate(size);
+    reserve(size);
+    for (; m_size < size; m_size++)
+      constructDefault(m_size, detail::colTag<0>());
+  }
+
+  void clear() noexcept { truncate(0); }
+
+  void swap(smallSoaVector &other) {
+    smallSoaVector temp(std::move(other));
+    other = std::move(*this);
+    *this = std::move(temp);
+  }
+
+  //___________________________Columns_______________________________
+
+  // Field I of every row, contiguous
+  template <size_t I>
+  col<I> *data() noexcept {
+    return columnIn<I>(storage(), m_alloc);
+  }
+
+  template <size_t I>
+  const col<I> *data() const noexcept {
+    return columnIn<I>(const_cast<smallSoaVector *>(this)->storage(), m_alloc);
+  }
+
+  template <size_t I>
+  span<col<I>> column() noexcept {
+    return span<col<I>>(data<I>(), m_size);
+  }
+
+  template <size_t I>
+  span<const col<I>> column() const noexcept {
+    return span<const col<I>>(data<I>(), m_size);
+  }
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() { return iterator(this, 0); }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+
+  iterator end() { return iterator(this, m_size); }
+
+  const_iterator end() const { return const_iterator(this, m_size); }
+
+  //___________________________Getters_______________________________
+
+  size_t size() const noexcept { return m_size; }
+
+  bool empty() const noexcept { return m_size == 0; }
+
+  size_t capacity() const noexcept { return m_alloc; }
+
+  reference front() { return (*this)[0]; }
+
+  const_reference front() const { return (*this)[0]; }
+
+  reference back() { return (*this)[m_size - 1]; }
+
+  const_reference back() const { return (*this)[m_size - 1]; }
+
+  allocator_type get_allocator() const { return Alloc(getAllocator()); }
+
+  // Heap allocation in rows, 0 while inline
+  size_t getAlloc() const { return m_data ? m_alloc : 0; }
+
+  // Bytes of the heap block, 0 while inline
+  size_t heapBytes() const {
+    return m_data ? unitsFor(m_alloc) * sizeof(unit) : 0;
+  }
+
+  //___________________________Private func_______________________________
+
+ private:
+  using allocBase::getAllocator;
+
+  char *storage() noexcept { return m_data ? m_data : m_buff; }
+
+  template <size_t I>
+  static col<I> *columnIn(char *block, size_t cap) noexcept {
+    return reinterpret_cast<col<I> *>(
+        block + layout::offset(detail::colTag<I>(), cap));
+  }
+
+  template <size_t... Is>
+  reference row(size_t ind, detail::indexSeq<Is...>) {
+    return reference(data<Is>()[ind]...);
+  }
+
+  template <size_t... Is>
+  const_reference row(size_t ind, detail::indexSeq<Is...>) const {
+    return const_reference(data<Is>()[ind]...);
+  }
+
+  template <typename Tup, size_t... Is>
+  void pushTuple(Tup &&row, detail::indexSeq<Is...>) {
+    emplace_back(std::get<Is>(std::forward<Tup>(row))...);
+  }
+
+  // Growth follows the Growth policy, with the bytes of a row as element
+  // size
+  size_t nextCapacity(size_t need) const noexcept {
+    size_t next = Growth::next(m_alloc, need, layout::blockBytes(1));
+    if (next > UINT32_MAX) next = UINT32_MAX;
+    return next > need ? next : need;
+  }
+
+  // Cold half of emplace_back. The row is built first, vals may refer to
+  // fields that the growth moves away.
+  template <typename... Us>
+  MPC_SV_COLD void growAndEmplace(Us &&...vals) {
+    value_type temp(std::forward<Us>(vals)...);
+    reserve(nextCapacity(m_size + 1));
+    emplaceTuple(std::move(temp), columns());
+  }
+
+  template <size_t... Is>
+  void emplaceTuple(value_type &&row, detail::indexSeq<Is...>) {
+    constructRow<0>(m_size, std::get<Is>(std::move(row))...);
+    m_size++;
+  }
+
+  // Builds field I of row ind and the ones after it, undoes field I when a
+  // later one throws
+  template <size_t I, typename U, typename... Us>
+  void constructRow(size_t ind, U &&val, Us &&...vals) {
+    col<I> *p = data<I>() + ind;
+    new (p) col<I>(std::forward<U>(val));
+    MPC_SV_TRY { constructRow<I + 1>(ind, std::forward<Us>(vals)...); }
+    MPC_SV_CATCH_ALL {
+      p->~col<I>();
+      MPC_SV_RETHROW;
+    }
+  }
+
+  template <size_t I>
+  void constructRow(size_t) noexcept {}
+
+  template <size_t I>
+  void constructDefault(size_t ind, detail::colTag<I>) {
+    col<I> *p = data<I>() + ind;
+    new (p) col<I>();
+    MPC_SV_TRY { constructDefault(ind, detail::colTag<I + 1>()); }
+    MPC_SV_CATCH_ALL {
+      p->~col<I>();
+      MPC_SV_RETHROW;
+    }
+  }
+
+  void constructDefault(size_t, detail::colTag<K>) noexcept {}
+
+  // Constructs the rows of src into a block of cap rows, moving when Move
+  // and the move cannot throw. On throw nothing is left in the block.
+  template <typename Move, size_t I>
+  static void constructColumns(const smallSoaVector &src, char *block,
+                               size_t cap, Move, detail::colTag<I>) {
+    col<I> *from = const_cast<col<I> *>(src.template data<I>());
+    col<I> *to = columnIn<I>(block, cap);
+    copyColumn(from, from + src.m_size, to,
+               std::integral_constant<
+                   bool, Move::value &&
+                             std::is_nothrow_move_constructible<col<I>>::value>());
+    MPC_SV_TRY {
+      constructColumns(src, block, cap, Move(), detail::colTag<I + 1>());
+    }
+    MPC_SV_CATCH_ALL {
+      detail::destroyRange(to, to + src.m_size);
+      MPC_SV_RETHROW;
+    }
+  }
+
+  template <typename Move>
+  static void constructColumns(const smallSoaVector &, char *, size_t, Move,
+                               detail::colTag<K>) noexcept {}
+
+  template <typename T>
+  static void copyColumn(T *first, T *last, T *dest, std::true_type) {
+    std::uninitialized_copy(std::make_move_iterator(first),
+                            std::make_move_iterator(last), dest);
+  }
+
+  template <typename T>
+  static void copyColumn(T *first, T *last, T *dest, std::false_type) {
+    detail::copyRange(static_cast<const T *>(first),
+                      static_cast<const T *>(last), dest);
+  }
+
+  template <size_t I>
+  void destroyRows(size_t from, size_t to, detail::colTag<I>) noexcept {
+    detail::destroyRange(data<I>() + from, data<I>() + to);
+    destroyRows(from, to, detail::colTag<I + 1>());
+  }
+
+  void destroyRows(size_t, size_t, detail::colTag<K>) noexcept {}
+
+  // Move assigns row from over row to
+  template <size_t I>
+  void moveRow(size_t to, size_t from, detail::colTag<I>) {
+    data<I>()[to] = std::move(data<I>()[from]);
+    moveRow(to, from, detail::colTag<I + 1>());
+  }
+
+  void moveRow(size_t, size_t, detail::colTag<K>) noexcept {}
+
+  // Expects this to be empty, moves the rows of src when Move and the moves
+  // cannot throw
+  template <typename Move>
+  void appendRows(const smallSoaVector &src, Move) {
+    reserve(src.m_size);
+    constructColumns(src, storage(), m_alloc, Move(), detail::colTag<0>());
+    m_size = src.m_size;
+  }
+
+  void truncate(size_t size) noexcept {
+    destroyRows(size, m_size, detail::colTag<0>());
+    m_size = static_cast<uint32_t>(size);
+  }
+
+  // Expects this to be empty and inline, other is left empty and inline
+  void takeFrom(smallSoaVector &other) noexcept(
+      std::is_nothrow_move_constructible<std::tuple<Ts...>>::value) {
+    if (other.m_data) {
+      m_data = other.m_data;
+      m_alloc = other.m_alloc;
+      other.m_data = nullptr;
+      other.m_alloc = N;
+    } else {
+      constructColumns(other, m_buff, N, std::true_type(),
+                       detail::colTag<0>());
+      other.destroyRows(0, other.m_size, detail::colTag<0>());
+    }
+    m_size = other.m_size;
+    other.m_size = 0;
+  }
+
+  void freeHeap() noexcept {
+    if (m_data)
+      allocTraits::deallocate(getAllocator(), reinterpret_cast<unit *>(m_data),
+                              unitsFor(m_alloc));
+  }
+
+  // Back to the inline buffer, expects this to be empty
+  void dropHeap() noexcept {
+    freeHeap();
+    m_data = nullptr;
+    m_alloc = N;
+  }
+};
+
+template <typename Tuple, size_t N, typename Alloc, typename Growth>
+void swap(smallSoaVector<Tuple, N, Alloc, Growth> &avec,
+          smallSoaVector<Tuple, N, Alloc, Growth> &bvec) {
+  avec.swap(bvec);
+}
+
+}  // namespace mpc
+
+#endif  // MPC_SMALLSOAVECTOR
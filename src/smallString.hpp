@@ -0,0 +1,493 @@
+#ifndef MPC_SMALLSTRING
+#define MPC_SMALLSTRING
+
+// String on smallVector<char, N> storage: N - 1 characters stay inline
+// (31 for the default N, std::string keeps 15), longer ones spill to the
+// heap with the usual growth. The characters are always followed by a
+// '\0' in the buffer, so c_str() is data() and never allocates. Compare and
+// find go through memcmp / memchr, which the C library vectorizes. Converts
+// to and from std::string_view when built as C++17.
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "smallVector.hpp"
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <string_view>
+#define MPC_SV_HAS_STRING_VIEW 1
+#else
+#define MPC_SV_HAS_STRING_VIEW 0
+#endif
+
+namespace mpc {
+
+namespace detail {
+
+inline uint64_t load64(const char *p) noexcept {
+  uint64_t res;
+  std::memcpy(&res, p, sizeof(res));
+  return res;
+}
+
+inline uint64_t load32(const char *p) noexcept {
+  uint32_t res;
+  std::memcpy(&res, p, sizeof(res));
+  return res;
+}
+
+inline uint64_t mix64(uint64_t h) noexcept {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Eight bytes per multiply. The tail is read with two overlapping 4 byte
+// loads (or three single bytes) rather than a memcpy of variable length,
+// which would be a library call. The length is in the seed.
+inline size_t hashBytes(const char *p, size_t n) noexcept {
+  const uint64_t k = 0x87c37b91114253d5ULL;
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ (n * 0x100000001b3ULL);
+  for (; n >= 8; p += 8, n -= 8) h = (h ^ load64(p)) * k;
+  if (n >= 4) {
+    h = (h ^ (load32(p) << 32 | load32(p + n - 4))) * k;
+  } else if (n) {
+    const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+    h = (h ^ (uint64_t(u[0]) << 16 | uint64_t(u[n >> 1]) << 8 | u[n - 1])) *
+        k;
+  }
+  return static_cast<size_t>(mix64(h));
+}
+
+inline int compareBytes(const char *a, size_t an, const char *b,
+                        size_t bn) noexcept {
+  size_t n = an < bn ? an : bn;
+  int res = n ? std::memcmp(a, b, n) : 0;
+  if (res) return res;
+  return an < bn ? -1 : an > bn ? 1 : 0;
+}
+
+}  // namespace detail
+
+template <size_t N = 32, typename Alloc = std::allocator<char>,
+          typename Growth = growDouble>
+class smallString {
+  static_assert(N >= 1, "the inline buffer holds at least the '\\0'");
+
+  // Member variables
+  // The characters and a '\0', size() + 1 elements
+  smallVector<char, N, Alloc, Growth> m_vec;
+
+ public:
+  // Public member types
+  typedef char value_type;
+  typedef char &reference;
+  typedef const char &const_reference;
+  typedef char *pointer;
+  typedef const char *const_pointer;
+  typedef char *iterator;
+  typedef const char *const_iterator;
+  typedef Alloc allocator_type;
+
+  // find() result when nothing matches, count meaning "up to the end"
+  static const size_t npos = size_t(-1);
+
+  //====================Ctors====================
+
+  smallString() : smallString(Alloc()) {}
+
+  explicit smallString(const Alloc &alloc) : m_vec(alloc) {
+    m_vec.push_back('\0');
+  }
+
+  smallString(const char *str) : smallString() { append(str); }
+
+  smallString(const char *str, size_t n) : smallString() { append(str, n); }
+
+  // n copies of c
+  smallString(size_t n, char c) : smallString() { append(n, c); }
+
+  explicit smallString(const std::string &str) : smallString() {
+    append(str.data(), str.size());
+  }
+
+#if MPC_SV_HAS_STRING_VIEW
+  explicit smallString(std::string_view str) : smallString() {
+    append(str.data(), str.size());
+  }
+#endif
+
+  smallString(const smallString &other) = default;
+
+  // Leaves other empty
+  smallString(smallString &&other) noexcept(
+      std::is_nothrow_move_constructible<
+          smallVector<char, N, Alloc, Growth>>::value)
+      : m_vec(std::move(other.m_vec)) {
+    other.reset();
+  }
+
+  //___________________________Operators_______________________________
+
+  smallString &operator=(const smallString &other) = default;
+
+  // Leaves other empty
+  smallString &operator=(smallString &&other) {
+    if (this == &other) return *this;
+    m_vec = std::move(other.m_vec);
+    other.reset();
+    return *this;
+  }
+
+  smallString &operator=(const char *str) {
+    return assign(str, std::strlen(str));
+  }
+
+  char &operator[](size_t ind) {
+    assert(ind <= size());
+    return m_vec[ind];
+  }
+
+  const char &operator[](size_t ind) const {
+    assert(ind <= size());
+    return m_vec[ind];
+  }
+
+  smallString &operator+=(char c) {
+    push_back(c);
+    return *this;
+  }
+
+  smallString &operator+=(const char *str) { return append(str); }
+
+  smallString &operator+=(const smallString &str) {
+    return append(str.data(), str.size());
+  }
+
+  smallString &operator+=(const std::string &str) {
+    return append(str.data(), str.size());
+  }
+
+#if MPC_SV_HAS_STRING_VIEW
+  smallString &operator+=(std::string_view str) {
+    return append(str.data(), str.size());
+  }
+
+  operator std::string_view() const noexcept {
+    return std::string_view(data(), size());
+  }
+#endif
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  // Bulk append, one capacity check and one memcpy. str may point into
+  // this string.
+  smallString &append(const char *str, size_t n) {
+    const char *base = m_vec.data();
+    bool inside = str >= base && str < base + size();
+    size_t offset = inside ? str - base : 0;
+    char *dest = m_vec.append_uninitialized(n) - 1;
+    if (inside) str = m_vec.data() + offset;
+    if (n) std::memcpy(dest, str, n);
+    dest[n] = '\0';
+    return *this;
+  }
+
+  smallString &append(const char *str) {
+    return append(str, std::strlen(str));
+  }
+
+  // n copies of c
+  smallString &append(size_t n, char c) {
+    char *dest = m_vec.append_uninitialized(n) - 1;
+    if (n) std::memset(dest, c, n);
+    dest[n] = '\0';
+    return *this;
+  }
+
+  // Decimal digits of val, without a locale or snprintf
+  template <typename I, typename = typename std::enable_if<
+                            std::is_integral<I>::value>::type>
+  smallString &append_int(I val) {
+    typedef typename std::make_unsigned<I>::type U;
+    char buf[24];
+    char *first = buf + sizeof(buf);
+    bool neg = val < 0;
+    U u = neg ? U(0) - static_cast<U>(val) : static_cast<U>(val);
+    do {
+      *--first = static_cast<char>('0' + u % 10);
+      u /= 10;
+    } while (u);
+    if (neg) *--first = '-';
+    return append(first, buf + sizeof(buf) - first);
+  }
+
+  void push_back(char c) {
+    m_vec.back() = c;
+    m_vec.push_back('\0');
+  }
+
+  void pop_back() noexcept {
+    assert(!empty());
+    m_vec.pop_back();
+    m_vec.back() = '\0';
+  }
+
+  smallString &assign(const char *str, size_t n) {
+    if (str >= data() && str < data() + size()) {
+      // Part of this string, move it to the front
+      std::memmove(m_vec.data(), str, n);
+      return resize(n);
+    }
+    clear();
+    return append(str, n);
+  }
+
+  // Erases n characters from pos on, up to the end for npos
+  smallString &erase(size_t pos = 0, size_t n = npos) {
+    assert(pos <= size());
+    if (n > size() - pos) n = size() - pos;
+    m_vec.erase(m_vec.begin() + pos, m_vec.begin() + pos + n);
+    return *this;
+  }
+
+  // New characters are copies of c
+  smallString &resize(size_t n, char c = '\0') {
+    if (n > size()) return append(n - size(), c);
+    m_vec.resize(n + 1);
+    m_vec[n] = '\0';
+    return *this;
+  }
+
+  // Room for n characters
+  void reserve(size_t n) { m_vec.reserve(n + 1); }
+
+  void shrink_to_fit() { m_vec.shrink_to_fit(); }
+
+  // Capacity is kept
+  void clear() noexcept {
+    m_vec.clear();
+    m_vec.push_back('\0');
+  }
+
+  void swap(smallString &other) noexcept(noexcept(m_vec.swap(other.m_vec))) {
+    m_vec.swap(other.m_vec);
+  }
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() noexcept { return m_vec.begin(); }
+
+  const_iterator begin() const noexcept { return m_vec.begin(); }
+
+  iterator end() noexcept { return m_vec.begin() + size(); }
+
+  const_iterator end() const noexcept { return m_vec.begin() + size(); }
+
+  //___________________________Getters_______________________________
+
+  size_t size() const noexcept { return m_vec.size() - 1; }
+
+  size_t length() const noexcept { return size(); }
+
+  bool empty() const noexcept { return size() == 0; }
+
+  // Characters that fit without growing
+  size_t capacity() const noexcept { return m_vec.capacity() - 1; }
+
+  char *data() noexcept { return m_vec.data(); }
+
+  const char *data() const noexcept { return m_vec.data(); }
+
+  // Never allocates, the '\0' is always there
+  const char *c_str() const noexcept { return m_vec.data(); }
+
+  char &front() { return m_vec.front(); }
+
+  const char &front() const { return m_vec.front(); }
+
+  char &back() { return m_vec[size() - 1]; }
+
+  const char &back() const { return m_vec[size() - 1]; }
+
+  allocator_type get_allocator() const { return m_vec.get_allocator(); }
+
+  // Heap allocation in chars, 0 while inline
+  size_t getAlloc() const noexcept { return m_vec.getAlloc(); }
+
+  std::string str() const { return std::string(data(), size()); }
+
+  //___________________________Search_______________________________
+
+  // <0, 0 or >0 like memcmp, a prefix orders first
+  int compare(const char *str, size_t n) const noexcept {
+    return detail::compareBytes(data(), size(), str, n);
+  }
+
+  int compare(const char *str) const noexcept {
+    return compare(str, std::strlen(str));
+  }
+
+  template <size_t M, typename A, typename G>
+  int compare(const smallString<M, A, G> &other) const noexcept {
+    return compare(other.data(), other.size());
+  }
+
+  // First c at or after pos
+  size_t find(char c, size_t pos = 0) const noexcept {
+    if (pos >= size()) return npos;
+    const void *hit = std::memchr(data() + pos, c, size() - pos);
+    return hit ? static_cast<const char *>(hit) - data() : npos;
+  }
+
+  // First occurrence of str[0, n) at or after pos, argument order of
+  // std::string: memchr for the first character, memcmp for the rest
+  size_t find(const char *str, size_t pos, size_t n) const noexcept {
+    if (n == 0) return pos <= size() ? pos : npos;
+    if (pos >= size() || n > size() - pos) return npos;
+    const char *last = data() + size() - n;
+    for (const char *it = data() + pos; it <= last; it++) {
+      it = static_cast<const char *>(std::memchr(it, str[0], last - it + 1));
+      if (!it) return npos;
+      if (std::memcmp(it + 1, str + 1, n - 1) == 0) return it - data();
+    }
+    return npos;
+  }
+
+  size_t find(const char *str, size_t pos = 0) const noexcept {
+    return find(str, pos, std::strlen(str));
+  }
+
+  bool starts_with(const char *str, size_t n) const noexcept {
+    return n <= size() && (n == 0 || std::memcmp(data(), str, n) == 0);
+  }
+
+  bool starts_with(const char *str) const noexcept {
+    return starts_with(str, std::strlen(str));
+  }
+
+  bool ends_with(const char *str, size_t n) const noexcept {
+    return n <= size() &&
+           (n == 0 || std::memcmp(data() + size() - n, str, n) == 0);
+  }
+
+  bool ends_with(const char *str) const noexcept {
+    return ends_with(str, std::strlen(str));
+  }
+
+  // Characters [pos, pos + n), up to the end for npos
+  smallString substr(size_t pos = 0, size_t n = npos) const {
+    assert(pos <= size());
+    if (n > size() - pos) n = size() - pos;
+    return smallString(data() + pos, n);
+  }
+
+  // Same value for equal strings of any N
+  size_t hash() const noexcept { return detail::hashBytes(data(), size()); }
+
+  //___________________________Private func_______________________________
+
+ private:
+  // Empty with the '\0', after other moved our elements away
+  void reset() noexcept {
+    m_vec.clear();
+    m_vec.push_back('\0');
+  }
+};
+
+//====================Comparisons====================
+
+template <size_t N, typename A, typename G, size_t M, typename B, typename H>
+bool operator==(const smallString<N, A, G> &a,
+                const smallString<M, B, H> &b) noexcept {
+  return a.size() == b.size() && a.compare(b) == 0;
+}
+
+template <size_t N, typename A, typename G, size_t M, typename B, typename H>
+bool operator!=(const smallString<N, A, G> &a,
+                const smallString<M, B, H> &b) noexcept {
+  return !(a == b);
+}
+
+template <size_t N, typename A, typename G, size_t M, typename B, typename H>
+bool operator<(const smallString<N, A, G> &a,
+               const smallString<M, B, H> &b) noexcept {
+  return a.compare(b) < 0;
+}
+
+template <size_t N, typename A, typename G, size_t M, typename B, typename H>
+bool operator>(const smallString<N, A, G> &a,
+               const smallString<M, B, H> &b) noexcept {
+  return b < a;
+}
+
+template <size_t N, typename A, typename G, size_t M, typename B, typename H>
+bool operator<=(const smallString<N, A, G> &a,
+                const smallString<M, B, H> &b) noexcept {
+  return !(b < a);
+}
+
+template <size_t N, typename A, typename G, size_t M, typename B, typename H>
+bool operator>=(const smallString<N, A, G> &a,
+                const smallString<M, B, H> &b) noexcept {
+  return !(a < b);
+}
+
+template <size_t N, typename A, typename G>
+bool operator==(const smallString<N, A, G> &a, const char *b) noexcept {
+  return a.compare(b) == 0;
+}
+
+template <size_t N, typename A, typename G>
+bool operator==(const char *a, const smallString<N, A, G> &b) noexcept {
+  return b.compare(a) == 0;
+}
+
+template <size_t N, typename A, typename G>
+bool operator!=(const smallString<N, A, G> &a, const char *b) noexcept {
+  return a.compare(b) != 0;
+}
+
+template <size_t N, typename A, typename G>
+bool operator!=(const char *a, const smallString<N, A, G> &b) noexcept {
+  return b.compare(a) != 0;
+}
+
+template <size_t N, typename A, typename G>
+std::ostream &operator<<(std::ostream &os, const smallString<N, A, G> &str) {
+  return os.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+// outside swap function
+template <size_t N, typename A, typename G>
+void swap(smallString<N, A, G> &astr, smallString<N, A, G> &bstr) noexcept(
+    noexcept(astr.swap(bstr))) {
+  astr.swap(bstr);
+}
+
+}  // namespace mpc
+
+namespace std {
+
+template <size_t N, typename A, typename G>
+struct hash<mpc::smallString<N, A, G>> {
+  size_t operator()(const mpc::smallString<N, A, G> &str) const noexcept {
+    return str.hash();
+  }
+};
+
+}  // namespace std
+
+#endif  // MPC_SMALLSTRING
@@ -4,133 +4,610 @@
 #include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdint>
 #include <cstdlib>
-#include <exception>
-#include <iostream>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
 #include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+//====================Configuration====================
+
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define MPC_SV_EXCEPTIONS 1
+#else
+#define MPC_SV_EXCEPTIONS 0
+#endif
+
+// Error policy for length errors and for the allocators shipped with mpc,
+// define MPC_SV_ERROR_POLICY before including to override: MPC_SV_THROW
+// throws std::length_error / std::bad_alloc, MPC_SV_ABORT calls
+// std::abort(). The try_* members return false for a capacity past the
+// 32 bit limit either way, but for a failed allocation only when it
+// arrives as std::bad_alloc: under MPC_SV_ABORT the mpc allocators, and
+// without exceptions every allocator, abort instead.
+#define MPC_SV_THROW 1
+#define MPC_SV_ABORT 2
+
+#ifndef MPC_SV_ERROR_POLICY
+#if MPC_SV_EXCEPTIONS
+#define MPC_SV_ERROR_POLICY MPC_SV_THROW
+#else
+#define MPC_SV_ERROR_POLICY MPC_SV_ABORT
+#endif
+#endif
+
+#if MPC_SV_ERROR_POLICY == MPC_SV_THROW && !MPC_SV_EXCEPTIONS
+#error "MPC_SV_THROW needs exceptions, use MPC_SV_ABORT with -fno-exceptions"
+#endif
+
+// Cleanup blocks that disappear with -fno-exceptions
+#if MPC_SV_EXCEPTIONS
+#define MPC_SV_TRY try
+#define MPC_SV_CATCH_ALL catch (...)
+#define MPC_SV_RETHROW throw
+#else
+#define MPC_SV_TRY if (true)
+#define MPC_SV_CATCH_ALL if (false)
+#define MPC_SV_RETHROW
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MPC_SV_LIKELY(x) __builtin_expect(!!(x), 1)
+#define MPC_SV_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#define MPC_SV_COLD __attribute__((noinline, cold))
+#elif defined(_MSC_VER)
+#define MPC_SV_LIKELY(x) (x)
+#define MPC_SV_UNLIKELY(x) (x)
+#define MPC_SV_COLD __declspec(noinline)
+#else
+#define MPC_SV_LIKELY(x) (x)
+#define MPC_SV_UNLIKELY(x) (x)
+#define MPC_SV_COLD
+#endif
+
+// Spill/growth/peak size statistics, see smallVectorStats.hpp
+#ifndef MPC_SV_STATS
+#define MPC_SV_STATS 0
+#endif
+
+#if MPC_SV_STATS
+#include "smallVectorStats.hpp"
+#endif
 
 namespace mpc {
-template <typename T, size_t N = 8>
-class smallVector {
-  // Member variables
-  T *m_data;
-  T *m_buffptr;
-  alignas(alignof(T)) char m_buff[sizeof(T) * N];
-  size_t m_alloc;
-  size_t m_size;
 
- public:
-  // Public member types
-  typedef T value_type;
-  typedef T &reference;
-  typedef const T &const_reference;
-  typedef T *pointer;
-  typedef const T *const_pointer;
-  typedef T *iterator;
-  typedef const T *const_iterator;
+// Types that can be moved to a new address with a plain memcpy, after which
+// the source bytes are dead and its destructor is not run. Defaults to
+// trivially copyable types; specialize to true_type for types that are not
+// trivially copyable but still relocate bitwise (e.g. std::unique_ptr).
+template <typename T>
+struct isTriviallyRelocatable
+    : std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                       std::is_trivially_destructible<T>::value> {
+};
 
-  //====================Ctors and Dtors====================
+namespace detail {
 
-  // Default constructor
-  smallVector()
-      : m_data(nullptr),
-        m_buffptr(reinterpret_cast<T *>(m_buff)),
-        m_alloc(0),
-        m_size(0) {}
+// Error reporting following MPC_SV_ERROR_POLICY, kept out of line
+[[noreturn]] MPC_SV_COLD inline void throwLengthError(const char *what) {
+#if MPC_SV_ERROR_POLICY == MPC_SV_THROW
+  throw std::length_error(what);
+#else
+  (void)what;
+  std::abort();
+#endif
+}
 
-  // Constructor with given size
-  smallVector(const size_t sz) : smallVector() { resize(sz); }
+[[noreturn]] MPC_SV_COLD inline void throwOutOfRange(const char *what) {
+#if MPC_SV_ERROR_POLICY == MPC_SV_THROW
+  throw std::out_of_range(what);
+#else
+  (void)what;
+  std::abort();
+#endif
+}
 
-  // Copy constructor
-  smallVector(const smallVector &other) : smallVector() {
-    // std::cout<<"Copy constr called"<<std::endl;
-    try {
-      reserve(other.m_size);
-    } catch (std::exception &e) {
-      this->nearlyDestroy();
-      std::cout << e.what() << std::endl;
-      throw;
-    }
-    std::uninitialized_copy(other.begin(), other.end(), begin());
-    m_size = other.m_size;
-    m_alloc = other.m_alloc;
+[[noreturn]] MPC_SV_COLD inline void throwBadAlloc() {
+#if MPC_SV_ERROR_POLICY == MPC_SV_THROW
+  throw std::bad_alloc();
+#else
+  std::abort();
+#endif
+}
+
+// Element range helpers, dispatched at compile time. The trivial overloads
+// collapse to a single memcpy or to nothing.
+
+template <typename T>
+void destroyRange(T *, T *, std::true_type) noexcept {}
+
+template <typename T>
+void destroyRange(T *first, T *last, std::false_type) noexcept {
+  for (; first != last; ++first) first->~T();
+}
+
+template <typename T>
+void destroyRange(T *first, T *last) noexcept {
+  destroyRange(first, last, std::is_trivially_destructible<T>());
+}
+
+// Copy constructs [first, last) into raw storage at dest, one memcpy when
+// the source is a T pointer and T is trivially copyable
+template <typename It, typename T>
+void copyRange(It first, It last, T *dest, std::true_type) {
+  if (first != last)
+    std::memcpy(static_cast<void *>(dest), static_cast<const void *>(first),
+                (last - first) * sizeof(T));
+}
+
+template <typename It, typename T>
+void copyRange(It first, It last, T *dest, std::false_type) {
+  std::uninitialized_copy(first, last, dest);
+}
+
+template <typename It, typename T>
+void copyRange(It first, It last, T *dest) {
+  copyRange(first, last, dest,
+            std::integral_constant<
+                bool, std::is_pointer<It>::value &&
+                          std::is_same<typename std::remove_cv<
+                                           typename std::remove_pointer<
+                                               It>::type>::type,
+                                       T>::value &&
+                          std::is_trivially_copyable<T>::value>());
+}
+
+// Iterator pair rather than (count, value)
+template <typename It>
+using requireIter =
+    typename std::enable_if<!std::is_integral<It>::value>::type;
+
+// Moves [first, last) into raw storage at dest and ends the source lifetimes.
+// Strong exc. guar.: on throw the source is untouched (move_if_noexcept).
+template <typename T>
+void relocateRange(T *first, T *last, T *dest, std::true_type) noexcept {
+  if (first != last)
+    std::memcpy(static_cast<void *>(dest), static_cast<const void *>(first),
+                (last - first) * sizeof(T));
+}
+
+template <typename T>
+void relocateRange(T *first, T *last, T *dest, std::false_type) {
+  T *out = dest;
+  MPC_SV_TRY {
+    for (T *it = first; it != last; ++it, ++out)
+      new (out) T(std::move_if_noexcept(*it));
   }
+  MPC_SV_CATCH_ALL {
+    destroyRange(dest, out);
+    MPC_SV_RETHROW;
+  }
+  destroyRange(first, last);
+}
 
-  // Move constructor
-  smallVector(smallVector &&other) noexcept {
-    // std::cout<<"Move constr called"<<std::endl;
-    if (other.begin() == other.m_buffptr) {
-      m_buffptr = other.m_buffptr;
-      other.m_buffptr = nullptr;
-    } else {
-      m_data = other.m_data;
-      other.m_data = nullptr;
+template <typename T>
+void relocateRange(T *first, T *last, T *dest) {
+  relocateRange(first, last, dest, isTriviallyRelocatable<T>());
+}
+
+// Element shifts shared by smallVectorBase and staticVector, the true_type
+// overloads memmove trivially relocatable T.
+
+// Moves [pos, end) up by n into raw storage, leaving n dead slots at pos.
+// Trivially relocatable T only.
+template <typename T>
+T *openGap(T *pos, T *end, size_t n) noexcept {
+  std::memmove(static_cast<void *>(pos + n), static_cast<void *>(pos),
+               (end - pos) * sizeof(T));
+  return pos;
+}
+
+// Undoes openGap, end is the end from before the gap
+template <typename T>
+void closeGap(T *pos, T *end, size_t n) noexcept {
+  std::memmove(static_cast<void *>(pos), static_cast<void *>(pos + n),
+               (end - pos) * sizeof(T));
+}
+
+// Erases [pos, pos + n) from a range ending at end, the last n slots are
+// left dead
+template <typename T>
+void eraseShift(T *pos, T *end, size_t n, std::true_type) noexcept {
+  destroyRange(pos, pos + n);
+  std::memmove(static_cast<void *>(pos), static_cast<void *>(pos + n),
+               (end - pos - n) * sizeof(T));
+}
+
+template <typename T>
+void eraseShift(T *pos, T *end, size_t n, std::false_type) {
+  std::move(pos + n, end, pos);
+  destroyRange(end - n, end);
+}
+
+// *dest = last, last is left dead
+template <typename T>
+void moveOver(T *dest, T *last, std::true_type) noexcept {
+  dest->~T();
+  std::memcpy(static_cast<void *>(dest), static_cast<void *>(last),
+              sizeof(T));
+}
+
+template <typename T>
+void moveOver(T *dest, T *last, std::false_type) {
+  *dest = std::move(*last);
+  last->~T();
+}
+
+// Insertion and erasure of smallVectorBase and staticVector, written once.
+// V provides begin(), end(), size(), back() and emplace_back(), and to its
+// friend vectorOps makeRoom(n), which grows or reports an error when n
+// more elements do not fit, setSize(size) and truncate(size).
+template <typename V>
+struct vectorOps {
+  typedef typename V::value_type T;
+  typedef isTriviallyRelocatable<T> relocatable;
+
+  template <typename It>
+  static void appendRange(V &vec, It first, It last, std::input_iterator_tag) {
+    for (; first != last; ++first) vec.emplace_back(*first);
+  }
+
+  template <typename It>
+  static void appendRange(V &vec, It first, It last,
+                          std::forward_iterator_tag) {
+    size_t n = std::distance(first, last);
+    vec.makeRoom(n);
+    copyRange(first, last, vec.end());
+    vec.setSize(vec.size() + n);
+  }
+
+  // val must not live in vec
+  static void appendFill(V &vec, size_t n, const T &val) {
+    vec.makeRoom(n);
+    std::uninitialized_fill_n(vec.end(), n, val);
+    vec.setSize(vec.size() + n);
+  }
+
+  // Single pass ranges are appended and rotated into place
+  template <typename It>
+  static void insertRange(V &vec, size_t index, It first, It last,
+                          std::input_iterator_tag) {
+    appendAndRotate(vec, index, first, last, std::input_iterator_tag());
+  }
+
+  template <typename It>
+  static void insertRange(V &vec, size_t index, It first, It last,
+                          std::forward_iterator_tag) {
+    insertForward(vec, index, first, last, relocatable());
+  }
+
+  // The tail is memmoved out of the way and the range copied into the gap
+  template <typename It>
+  static void insertForward(V &vec, size_t index, It first, It last,
+                            std::true_type) {
+    size_t n = std::distance(first, last);
+    T *gap = makeGap(vec, index, n);
+    MPC_SV_TRY { copyRange(first, last, gap); }
+    MPC_SV_CATCH_ALL {
+      closeGap(gap, vec.end(), n);
+      MPC_SV_RETHROW;
     }
-    m_alloc = other.m_alloc;
-    m_size = other.m_size;
-    other.m_size = 0;
-    other.m_alloc = 0;
+    vec.setSize(vec.size() + n);
   }
 
-  // Conversion constructor
-  smallVector(std::initializer_list<T> init) : smallVector() {
-    try {
-      reserve(init.size());
-    } catch (std::exception &e) {
-      this->nearlyDestroy();
-      std::cout << e.what() << std::endl;
-      throw;
+  template <typename It>
+  static void insertForward(V &vec, size_t index, It first, It last,
+                            std::false_type) {
+    appendAndRotate(vec, index, first, last, std::forward_iterator_tag());
+  }
+
+  template <typename It, typename Tag>
+  static void appendAndRotate(V &vec, size_t index, It first, It last,
+                              Tag tag) {
+    size_t origSize = vec.size();
+    MPC_SV_TRY { appendRange(vec, first, last, tag); }
+    MPC_SV_CATCH_ALL {
+      vec.truncate(origSize);
+      MPC_SV_RETHROW;
     }
-    for (auto it = init.begin(); it != init.end(); it++) {
-      new (end()) T(*it);
-      m_size++;
+    std::rotate(vec.begin() + index, vec.begin() + origSize, vec.end());
+  }
+
+  // Makes room for n elements before index by memmoving the tail,
+  // the size is left unchanged. Trivially relocatable T only.
+  static T *makeGap(V &vec, size_t index, size_t n) {
+    vec.makeRoom(n);
+    return openGap(vec.begin() + index, vec.end(), n);
+  }
+
+  // val must not live in vec
+  static void insertFill(V &vec, size_t index, size_t n, const T &val,
+                         std::true_type) {
+    T *gap = makeGap(vec, index, n);
+    MPC_SV_TRY { std::uninitialized_fill_n(gap, n, val); }
+    MPC_SV_CATCH_ALL {
+      closeGap(gap, vec.end(), n);
+      MPC_SV_RETHROW;
     }
+    vec.setSize(vec.size() + n);
   }
 
-  // Destructor
-  ~smallVector() {
-    clear();
-    if (m_alloc) ::operator delete(m_data);
+  static void insertFill(V &vec, size_t index, size_t n, const T &val,
+                         std::false_type) {
+    size_t origSize = vec.size();
+    appendFill(vec, n, val);
+    std::rotate(vec.begin() + index, vec.begin() + origSize, vec.end());
+  }
+
+  // Relocates temp into a one element gap at index
+  static void emplaceShift(V &vec, size_t index, T &temp, std::true_type) {
+    T *gap = makeGap(vec, index, 1);
+    new (gap) T(std::move(temp));
+    vec.setSize(vec.size() + 1);
+  }
+
+  // Moves the tail up by one and move assigns temp into the hole
+  static void emplaceShift(V &vec, size_t index, T &temp, std::false_type) {
+    vec.emplace_back(std::move(vec.back()));
+    T *pos = vec.begin() + index;
+    std::move_backward(pos, vec.end() - 2, vec.end() - 1);
+    *pos = std::move(temp);
+  }
+
+  // Erases n elements from index on, the tail is memmoved for trivially
+  // relocatable T
+  static void erase(V &vec, size_t index, size_t n) {
+    eraseShift(vec.begin() + index, vec.end(), n, relocatable());
+    vec.setSize(vec.size() - n);
+  }
+
+  // Moves the last element into pos, order is not kept
+  static void unorderedErase(V &vec, T *pos) {
+    T *last = vec.end() - 1;
+    if (pos != last)
+      moveOver(pos, last, relocatable());
+    else
+      last->~T();
+    vec.setSize(vec.size() - 1);
+  }
+};
+
+inline size_t log2Floor(size_t v) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+  return sizeof(unsigned long long) * 8 - 1 -
+         __builtin_clzll(static_cast<unsigned long long>(v));
+#else
+  size_t res = 0;
+  while (v >>= 1) res++;
+  return res;
+#endif
+}
+
+template <typename...>
+struct voidType {
+  typedef void type;
+};
+
+// Allocator provides allocate_at_least(n) returning {ptr, count}
+template <typename Alloc, typename = void>
+struct hasAllocateAtLeast : std::false_type {};
+
+template <typename Alloc>
+struct hasAllocateAtLeast<
+    Alloc, typename voidType<decltype(std::declval<Alloc &>().allocate_at_least(
+               size_t()))>::type> : std::true_type {};
+
+// Allocator provides reallocate(p, oldN, newN) returning {ptr, count}, which
+// may extend the block in place. On failure it throws and p stays valid.
+template <typename Alloc, typename = void>
+struct hasReallocate : std::false_type {};
+
+template <typename Alloc>
+struct hasReallocate<
+    Alloc, typename voidType<decltype(std::declval<Alloc &>().reallocate(
+               std::declval<typename Alloc::value_type *>(), size_t(),
+               size_t()))>::type> : std::true_type {};
+
+// Rounds a block up to the malloc size class it would land in anyway
+// (jemalloc/tcmalloc style: 16 byte steps up to 128, then four classes per
+// power of two).
+inline size_t sizeClass(size_t bytes) noexcept {
+  if (bytes <= 16) return 16;
+  if (bytes <= 128) return (bytes + 15) & ~size_t(15);
+  size_t pow = 128;
+  while (pow * 2 < bytes) pow *= 2;
+  size_t step = pow / 4;
+  return (bytes + step - 1) / step * step;
+}
+
+// Allocator::is_always_equal when present, otherwise "stateless"
+template <typename Alloc, typename = void>
+struct allocAlwaysEqual : std::is_empty<Alloc> {};
+
+template <typename Alloc>
+struct allocAlwaysEqual<
+    Alloc, typename voidType<typename Alloc::is_always_equal>::type>
+    : std::integral_constant<bool, Alloc::is_always_equal::value> {};
+
+// Alloc::alignment when present (e.g. alignedAllocator), otherwise
+// alignof(value_type)
+template <typename Alloc, typename = void>
+struct allocAlignment
+    : std::integral_constant<size_t, alignof(typename Alloc::value_type)> {};
+
+template <typename Alloc>
+struct allocAlignment<Alloc,
+                      typename voidType<decltype(Alloc::alignment)>::type>
+    : std::integral_constant<size_t, Alloc::alignment> {};
+
+// Keeps the allocator without taking space when it is stateless
+template <typename Alloc, bool = std::is_empty<Alloc>::value>
+class allocHolder : private Alloc {
+ public:
+  explicit allocHolder(const Alloc &alloc) : Alloc(alloc) {}
+  Alloc &getAllocator() noexcept { return *this; }
+  const Alloc &getAllocator() const noexcept { return *this; }
+};
+
+template <typename Alloc>
+class allocHolder<Alloc, false> {
+  Alloc m_allocator;
+
+ public:
+  explicit allocHolder(const Alloc &alloc) : m_allocator(alloc) {}
+  Alloc &getAllocator() noexcept { return m_allocator; }
+  const Alloc &getAllocator() const noexcept { return m_allocator; }
+};
+
+}  // namespace detail
+
+// Result of allocate_at_least(), count may exceed the request
+template <typename Pointer>
+struct allocationResult {
+  Pointer ptr;
+  size_t count;
+};
+
+// Heap block handed out by release() and taken over by adopt(): size
+// constructed elements in a block of capacity elements from the allocator
+template <typename T>
+struct releasedBuffer {
+  T *data;
+  size_t size;
+  size_t capacity;
+};
+
+//====================Growth policies====================
+// next(cap, need, elemSize) gives the capacity to grow to when a vector of
+// capacity cap (N while inline) has to hold need > cap elements.
+
+// cap * 2, the first spill goes to N * 2
+struct growDouble {
+  static size_t next(size_t cap, size_t need, size_t) noexcept {
+    return std::max(need, cap * 2);
   }
+};
+
+// cap * 1.5
+struct growHalf {
+  static size_t next(size_t cap, size_t need, size_t) noexcept {
+    return std::max(need, cap + cap / 2);
+  }
+};
+
+// cap + Chunk, rounded up to whole chunks
+template <size_t Chunk>
+struct growChunk {
+  static_assert(Chunk > 0, "chunk must not be empty");
+  static size_t next(size_t, size_t need, size_t) noexcept {
+    return (need + Chunk - 1) / Chunk * Chunk;
+  }
+};
+
+// cap * 1.5 rounded up to the allocator size class, so the slack malloc
+// would hand out anyway is counted as capacity
+struct growSizeClass {
+  static size_t next(size_t cap, size_t need, size_t elemSize) noexcept {
+    size_t want = std::max(need, cap + cap / 2);
+    return std::max(want, detail::sizeClass(want * elemSize) / elemSize);
+  }
+};
+
+// N-agnostic part of smallVector, in the style of LLVM's SmallVectorImpl:
+// growth, insertion and erasure are compiled once per (T, Alloc, Growth),
+// and functions can take a smallVectorBase<T>& to accept any inline
+// capacity. The inline buffer of the derived smallVector follows right after
+// this header. Heap blocks come from Alloc through std::allocator_traits;
+// elements are constructed in place. Stateless allocators take no space in
+// the object.
+template <typename T, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+class smallVectorBase : private detail::allocHolder<Alloc> {
+  static_assert(std::is_same<typename Alloc::value_type, T>::value,
+                "Alloc::value_type must be T");
+
+  typedef detail::allocHolder<Alloc> allocBase;
+  typedef std::allocator_traits<Alloc> allocTraits;
+  typedef std::integral_constant<
+      bool, allocTraits::propagate_on_container_move_assignment::value ||
+                detail::allocAlwaysEqual<Alloc>::value>
+      moveStealsHeap;
+  // Heap blocks of bitwise relocatable T can be grown by the allocator
+  typedef std::integral_constant<bool, isTriviallyRelocatable<T>::value &&
+                                           detail::hasReallocate<Alloc>::value>
+      canRealloc;
+
+  static_assert(std::is_same<typename allocTraits::pointer, T *>::value,
+                "fancy allocator pointers are not supported");
+
+  template <typename, size_t, typename, typename>
+  friend class smallVector;
+  friend struct detail::vectorOps<smallVectorBase>;
+  typedef detail::vectorOps<smallVectorBase> ops;
+
+  // The inline buffer is aligned like the heap blocks Alloc hands out
+  static const size_t inlineAlign =
+      detail::allocAlignment<Alloc>::value > alignof(T)
+          ? detail::allocAlignment<Alloc>::value
+          : alignof(T);
+
+  // Member variables
+  // m_data always points at the elements, the inline buffer or the heap
+  // block, so begin() is a plain load. Moves and swaps repoint it.
+  // m_alloc is the current capacity (N while inline).
+  T *m_data;
+  uint32_t m_size;
+  uint32_t m_alloc;
+#if MPC_SV_STATS
+  smallVectorStats *m_stats = nullptr;
+  size_t m_peak = 0;
+#endif
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+  typedef Alloc allocator_type;
+
+  smallVectorBase(const smallVectorBase &) = delete;
 
   //___________________________Operators_______________________________
 
-  // Copy op =
-  smallVector &operator=(const smallVector &other) {
-    // std::cout<<"Copy op= called"<<std::endl;
+  // Copy op =, keeps the heap block when it is big enough
+  smallVectorBase &operator=(const smallVectorBase &other) {
     if (this == &other) return *this;
-    this->nearlyDestroy();
-    try {
-      reserve(other.m_size);
-    } catch (std::exception &e) {
-      this->nearlyDestroy();
-      std::cout << e.what() << std::endl;
-      throw;
+    if (allocTraits::propagate_on_container_copy_assignment::value) {
+      if (!(getAllocator() == other.getAllocator()))
+        nearlyDestroy();
+      else
+        clear();
+      getAllocator() = other.getAllocator();
+    } else {
+      clear();
     }
-    std::uninitialized_copy(other.begin(), other.end(), begin());
+    reserve(other.m_size);
+    detail::copyRange(other.begin(), other.end(), begin());
     m_size = other.m_size;
-    m_alloc = other.m_alloc;
     return *this;
   }
 
-  // Move op =
-  smallVector &operator=(smallVector &&other) noexcept {
-    // std::cout<<"Move op= called"<<std::endl;
-    this->nearlyDestroy();
-    if (other.begin() == other.m_buffptr) {
-      m_buffptr = other.m_buffptr;
-      other.m_buffptr = nullptr;
-    } else {
-      m_data = other.m_data;
-      other.m_data = nullptr;
-    }
-    m_alloc = other.m_alloc;
-    m_size = other.m_size;
-    other.m_size = 0;
-    other.m_alloc = 0;
+  // Move op =, other may have any inline capacity
+  smallVectorBase &operator=(smallVectorBase &&other) {
+    if (this == &other) return *this;
+    moveAssign(other, moveStealsHeap());
     return *this;
   }
 
+
   // [] op
   reference operator[](size_t ind) { return *(begin() + ind); }
 
@@ -141,117 +618,248 @@ class smallVector {
   // manipulation_______________________________
 
   // Copies inp at the end of vec
-  void push_back(const T &inp) {
-    // std::cout<<"Copy PB called"<<std::endl;
-    try {
-      PbEbCheck(m_size + 1);
-    } catch (std::exception &e) {
-      std::cout << e.what() << std::endl;
-      throw;
-    }
-    new (end()) T(inp);
-    m_size++;
-  }
+  void push_back(const T &inp) { emplace_back(inp); }
 
   // Moves inp at the end of vec
-  void push_back(T &&inp) {
-    // std::cout<<"Move PB called"<<std::endl;
-    try {
-      PbEbCheck(m_size + 1);
-    } catch (std::exception &e) {
-      std::cout << e.what() << std::endl;
-      throw;
-    }
-    new (end()) T(std::move(inp));
+  void push_back(T &&inp) { emplace_back(std::move(inp)); }
+
+  // Emplace back, growth is kept out of line
+  template <typename... Ts>
+  void emplace_back(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(m_size == m_alloc))
+      return growAndEmplace(std::forward<Ts>(params)...);
+    new (end()) T(std::forward<Ts>(params)...);
     m_size++;
   }
 
-  // Emplace back
+  // Like push_back, but returns false instead of reporting an error when
+  // the vector cannot grow, see MPC_SV_ERROR_POLICY for which errors
+  bool try_push_back(const T &inp) { return try_emplace_back(inp); }
+
+  bool try_push_back(T &&inp) { return try_emplace_back(std::move(inp)); }
+
   template <typename... Ts>
-  void emplace_back(Ts &&...params) {
-    // std::cout<<"Emplace Back called"<<std::endl;
-    try {
-      PbEbCheck(m_size + 1);
-    } catch (std::exception &e) {
-      std::cout << e.what() << std::endl;
-      throw;
-    }
+  bool try_emplace_back(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(m_size == m_alloc))
+      return tryGrowAndEmplace(std::forward<Ts>(params)...);
     new (end()) T(std::forward<Ts>(params)...);
     m_size++;
+    return true;
+  }
+
+  // Appends [first, last), reserving once for forward ranges.
+  // The range must not point into this vector.
+  template <typename It, typename = detail::requireIter<It>>
+  void append(It first, It last) {
+    ops::appendRange(*this, first, last,
+                     typename std::iterator_traits<It>::iterator_category());
+  }
+
+  // Appends n copies of val
+  void append(size_t n, const T &val) {
+    // val may live in this vector, copy it before the growth moves it
+    T copy(val);
+    ops::appendFill(*this, n, copy);
+  }
+
+  void append(std::initializer_list<T> init) {
+    append(init.begin(), init.end());
+  }
+
+  // Appends n uninitialized elements and returns the first one, to be filled
+  // directly by read() or a decoder
+  T *append_uninitialized(size_t n) {
+    static_assert(std::is_trivially_default_constructible<T>::value &&
+                      std::is_trivially_destructible<T>::value,
+                  "append_uninitialized needs a trivial T");
+    PbEbCheck(m_size + n);
+    T *res = end();
+    m_size += static_cast<uint32_t>(n);
+    return res;
+  }
+
+  // Replaces the contents with [first, last)
+  template <typename It, typename = detail::requireIter<It>>
+  void assign(It first, It last) {
+    clear();
+    append(first, last);
+  }
+
+  void assign(size_t n, const T &val) {
+    clear();
+    append(n, val);
+  }
+
+  void assign(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+  }
+
+  // Inserts [first, last) before pos, reserving once for forward ranges.
+  // Returns iterator to the first inserted element.
+  template <typename It, typename = detail::requireIter<It>>
+  iterator insert(const_iterator pos, It first, It last) {
+    size_t index = pos - begin();
+    ops::insertRange(*this, index, first, last,
+                     typename std::iterator_traits<It>::iterator_category());
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  // Inserts n copies of val before pos
+  iterator insert(const_iterator pos, size_t n, const T &val) {
+    size_t index = pos - begin();
+    // val may live in this vector, copy it before anything moves
+    T copy(val);
+    ops::insertFill(*this, index, n, copy, isTriviallyRelocatable<T>());
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, const T &val) { return emplace(pos, val); }
+
+  iterator insert(const_iterator pos, T &&val) {
+    return emplace(pos, std::move(val));
+  }
+
+  // Constructs an element before pos
+  template <typename... Ts>
+  iterator emplace(const_iterator pos, Ts &&...params) {
+    size_t index = pos - begin();
+    if (index == m_size) {
+      emplace_back(std::forward<Ts>(params)...);
+      return end() - 1;
+    }
+    // params may refer to elements, build the value before shifting
+    T temp(std::forward<Ts>(params)...);
+    ops::emplaceShift(*this, index, temp, isTriviallyRelocatable<T>());
+    return begin() + index;
+  }
+
+  // Destroys the last element
+  void pop_back() noexcept {
+    assert(m_size);
+    notePeak();
+    (end() - 1)->~T();
+    m_size--;
+  }
+
+  // Erases the element at pos, returns iterator to the one after it
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  // Erases [first, last), the tail is memmoved for trivially relocatable T
+  iterator erase(const_iterator first, const_iterator last) {
+    size_t index = first - begin();
+    size_t n = last - first;
+    notePeak();
+    if (n) ops::erase(*this, index, n);
+    return begin() + index;
+  }
+
+  // O(1) erase that moves the last element into pos, order is not kept.
+  // Returns pos, which now holds the former last element.
+  iterator unordered_erase(const_iterator pos) {
+    iterator it = begin() + (pos - begin());
+    notePeak();
+    ops::unorderedErase(*this, it);
+    return it;
   }
 
   // Reserves at least inp in vec
   // Strong exc. guar.
   void reserve(size_t inp) {
-    // std::cout<<"Reserve called"<<std::endl;
-    if (m_alloc > inp || N >= inp) return;
-    T *temp = (T *)::operator new(inp * sizeof(T));
-    size_t origSize = m_size;
-    size_t i;
+    if (inp <= m_alloc) return;
+    if (inp > UINT32_MAX) detail::throwLengthError("smallVector::reserve");
+    moveToHeap(inp);
+  }
+
+  // Like reserve, but returns false instead of reporting an error, see
+  // MPC_SV_ERROR_POLICY for which errors
+  bool try_reserve(size_t inp) {
+    if (inp <= m_alloc) return true;
+    if (inp > UINT32_MAX) return false;
+#if MPC_SV_EXCEPTIONS
     try {
-      for (i = 0; i < m_size; i++)
-        new (temp + i) T(std::move_if_noexcept(*(begin() + i)));
-    } catch (std::exception &e) {
-      while (i) {
-        (temp + i - 1)->~T();
-        i--;
-      }
-      ::operator delete(temp);
-      std::cout << e.what() << std::endl;
-      throw;
+      moveToHeap(inp);
+    } catch (std::bad_alloc &) {
+      return false;
     }
-    this->nearlyDestroy();
-    m_data = temp;
-    m_size = origSize;
-    m_alloc = inp;
-  }
-
-  // strong exc. guarantee
-  void resize(size_t size, const T &val = T()) {
-    if (size == m_size) return;
-    if (size < m_size) {
-      while (size < m_size) {
-        (end() - 1)->~T();
-        m_size--;
-      }
-    } else {
-      try {
-        reserve(size);
-      } catch (std::exception &e) {
-        std::cout << e.what() << std::endl;
-        throw;
-      }
-      while (m_size < size) {
-        new (end()) T(val);
-        m_size++;
-      }
+#else
+    moveToHeap(inp);
+#endif
+    return true;
+  }
+
+  // Drops unused capacity, moves back into the inline buffer once the
+  // elements fit in N again. Strong exc. guar.
+  void shrink_to_fit() {
+    if (!onHeap() || m_size == m_alloc) return;
+    uint32_t inlineCap = savedInlineCap();
+    if (m_size > inlineCap) {
+      moveToHeap(m_size);
+      return;
+    }
+    T *block = m_data;
+    size_t blockAlloc = m_alloc;
+    MPC_SV_TRY {
+      detail::relocateRange(block, block + m_size, inlineBegin());
     }
+    MPC_SV_CATCH_ALL {
+      saveInlineCap(inlineCap);
+      MPC_SV_RETHROW;
+    }
+    allocTraits::deallocate(getAllocator(), block, blockAlloc);
+    m_data = inlineBegin();
+    m_alloc = inlineCap;
   }
 
-  // Destructs objs in vec, aloc is the same
-  void clear() noexcept {
-    while (m_size) {
-      (end() - 1)->~T();
-      m_size--;
+  // New elements are value-initialized in place
+  void resize(size_t size) {
+    if (size <= m_size) return truncate(size);
+    reserve(size);
+    while (m_size < size) {
+      new (end()) T();
+      m_size++;
     }
   }
 
-  //___________________________Iterator_______________________________
+  // New elements are copies of val
+  void resize(size_t size, const T &val) {
+    if (size <= m_size) return truncate(size);
+    T copy(val);
+    reserve(size);
+    while (m_size < size) {
+      new (end()) T(copy);
+      m_size++;
+    }
+  }
 
-  iterator begin() {
-    if (m_alloc)
-      return m_data;
-    else
-      return m_buffptr;
+  // New elements are default-initialized, i.e. left uninitialized for
+  // trivial T
+  void resize_for_overwrite(size_t size) {
+    if (size <= m_size) return truncate(size);
+    reserve(size);
+    while (m_size < size) {
+      new (end()) T;
+      m_size++;
+    }
   }
 
-  const_iterator begin() const {
-    if (m_alloc)
-      return m_data;
-    else
-      return m_buffptr;
+  // Destructs objs in vec, aloc is the same
+  // O(1) for trivially destructible T
+  void clear() noexcept {
+    notePeak();
+    detail::destroyRange(begin(), end());
+    m_size = 0;
   }
 
+  //___________________________Iterator_______________________________
+
+  iterator begin() noexcept { return m_data; }
+
+  const_iterator begin() const noexcept { return m_data; }
+
   iterator end() { return begin() + m_size; }
 
   const_iterator end() const { return begin() + m_size; }
@@ -260,73 +868,627 @@ class smallVector {
 
   size_t size() const noexcept { return m_size; }
 
-  size_t capacity() const noexcept {
-    if (m_alloc)
-      return m_alloc;
-    else
-      return N;
-  }
+  bool empty() const noexcept { return m_size == 0; }
+
+  size_t capacity() const noexcept { return m_alloc; }
 
   pointer data() { return begin(); }
 
   const_pointer data() const { return begin(); }
 
+  reference front() { return *begin(); }
+
+  const_reference front() const { return *begin(); }
+
+  reference back() { return *(end() - 1); }
+
+  const_reference back() const { return *(end() - 1); }
+
+  allocator_type get_allocator() const { return getAllocator(); }
+
   //___________________________Misc_______________________________
 
-  void swap(smallVector &other) noexcept {
-    // std::cout<<"swap called"<<std::endl;
-    if (begin() == m_data && other.begin() == other.m_data)
-      std::swap(m_data, other.m_data);
-    else if (begin() == m_buffptr && other.begin() == other.m_buffptr)
-      std::swap(m_buffptr, other.m_buffptr);
-    else {
-      std::swap(m_data, other.m_data);
-      std::swap(m_buffptr, other.m_buffptr);
+  // Swaps contents with a vector of any inline capacity. Allocates only when
+  // the inline elements of one side do not fit in the other's buffer.
+  void swap(smallVectorBase &other) {
+    if (this == &other) return;
+    notePeak();
+    other.notePeak();
+    // Without propagation the allocators have to be equal, as in std
+    if (!allocTraits::propagate_on_container_swap::value)
+      assert(getAllocator() == other.getAllocator());
+    swapElements(other);
+    // Last, so a block allocated for the swap goes along with the allocator
+    // that allocated it
+    if (allocTraits::propagate_on_container_swap::value) {
+      using std::swap;
+      swap(getAllocator(), other.getAllocator());
     }
-    std::swap(m_size, other.m_size);
-    std::swap(m_alloc, other.m_alloc);
+  }
+
+  //___________________________Ownership_______________________________
+
+  // Detaches the heap block, inline elements are first moved into an exact
+  // fit allocation. The caller destroys the elements and deallocates
+  // {data, capacity} with get_allocator(); the vector is left empty and
+  // inline. An empty inline vector gives {nullptr, 0, 0}.
+  releasedBuffer<T> release() {
+    if (!onHeap() && m_size) moveToHeap(m_size);
+    notePeak();
+    releasedBuffer<T> res = {nullptr, 0, 0};
+    if (onHeap()) {
+      res.data = m_data;
+      res.size = m_size;
+      res.capacity = m_alloc;
+      m_alloc = savedInlineCap();
+      m_data = inlineBegin();
+    }
+    m_size = 0;
+    return res;
+  }
+
+  // Takes ownership of buf, allocated by an allocator equal to
+  // get_allocator(), in place of the current contents. buf stays with the
+  // caller when the capacity does not fit in 32 bits.
+  void adopt(releasedBuffer<T> buf) {
+    assert(buf.size <= buf.capacity);
+    if (buf.capacity > UINT32_MAX)
+      detail::throwLengthError("smallVector::adopt");
+    nearlyDestroy();
+    if (!buf.data) return;
+    saveInlineCap(m_alloc);
+    m_data = buf.data;
+    m_size = static_cast<uint32_t>(buf.size);
+    m_alloc = static_cast<uint32_t>(buf.capacity);
   }
 
   //___________________________Debug_______________________________
 
-  size_t getAlloc() { return m_alloc; }
+  // Heap allocation in elements, 0 while inline
+  size_t getAlloc() const { return onHeap() ? m_alloc : 0; }
+
+  // N of the derived smallVector
+  size_t inlineCapacity() const noexcept {
+    return onHeap() ? savedInlineCap() : m_alloc;
+  }
 
   //___________________________Private func_______________________________
 
+ protected:
+  // Empty and inline, for smallVector only
+  smallVectorBase(size_t inlineCap, const Alloc &alloc)
+      : allocBase(alloc),
+        m_data(inlineBegin()),
+        m_size(0),
+        m_alloc(static_cast<uint32_t>(inlineCap)) {}
+
+  // Not virtual, a smallVectorBase is never owned on its own
+  ~smallVectorBase() {
+    clear();
+    freeHeap();
+#if MPC_SV_STATS
+    if (m_stats) m_stats->peak(m_peak);
+#endif
+  }
+
+  using allocBase::getAllocator;
+
+  // Takes the contents of other, which is left empty and inline.
+  // Expects this to be empty, and inline when other is on the heap.
+  void takeFrom(smallVectorBase &other) {
+    if (!other.onHeap()) return moveElementsFrom(other);
+    other.notePeak();
+    saveInlineCap(m_alloc);
+    m_data = other.m_data;
+    m_size = other.m_size;
+    m_alloc = other.m_alloc;
+    other.m_alloc = other.savedInlineCap();
+    other.m_data = other.inlineBegin();
+    other.m_size = 0;
+  }
+
+  // Relocates the elements of other into this (empty) vector, other keeps
+  // its storage. Strong exc. guar.
+  void moveElementsFrom(smallVectorBase &other) {
+    other.notePeak();
+    reserve(other.m_size);
+    detail::relocateRange(other.begin(), other.end(), begin());
+    m_size = other.m_size;
+    other.m_size = 0;
+  }
+
  private:
+  // Growth follows the Growth policy
   void PbEbCheck(size_t chckSize) {
-    if (chckSize > N) {
-      try {
-        reserve(N * 2);
-      } catch (std::exception &e) {
-        throw;
-      }
+    if (chckSize > m_alloc) reserve(nextCapacity(chckSize));
+  }
+
+  size_t nextCapacity(size_t chckSize) const noexcept {
+    size_t next = Growth::next(m_alloc, chckSize, sizeof(T));
+    if (next > UINT32_MAX) next = UINT32_MAX;
+    return std::max(next, chckSize);
+  }
+  // Cold half of emplace_back. The value is built first, params may refer
+  // to an element that the growth moves away.
+  template <typename... Ts>
+  MPC_SV_COLD void growAndEmplace(Ts &&...params) {
+    T temp(std::forward<Ts>(params)...);
+    reserve(nextCapacity(m_size + 1));
+    new (end()) T(std::move(temp));
+    m_size++;
+  }
+
+  template <typename... Ts>
+  MPC_SV_COLD bool tryGrowAndEmplace(Ts &&...params) {
+    T temp(std::forward<Ts>(params)...);
+    if (!try_reserve(nextCapacity(m_size + 1))) return false;
+    new (end()) T(std::move(temp));
+    m_size++;
+    return true;
+  }
+
+  // Destroys the elements past size
+  void truncate(size_t size) noexcept {
+    notePeak();
+    detail::destroyRange(begin() + size, end());
+    m_size = static_cast<uint32_t>(size);
+  }
+
+  // vectorOps hooks
+  void makeRoom(size_t n) { PbEbCheck(m_size + n); }
+
+  void setSize(size_t size) noexcept { m_size = static_cast<uint32_t>(size); }
+
+  // Relocates the elements into a heap block of at least inp elements
+  // Strong exc. guar.
+  void moveToHeap(size_t inp) { moveToHeap(inp, canRealloc()); }
+
+  // Already on the heap: the allocator resizes the block, in place if it can
+  void moveToHeap(size_t inp, std::true_type) {
+    if (!onHeap()) return moveToHeap(inp, std::false_type());
+    allocationResult<T *> res =
+        getAllocator().reallocate(m_data, m_alloc, inp);
+    m_data = res.ptr;
+    m_alloc = static_cast<uint32_t>(std::min<size_t>(res.count, UINT32_MAX));
+    noteAlloc(false);
+  }
+
+  void moveToHeap(size_t inp, std::false_type) {
+    T *temp = allocateBlock(inp, detail::hasAllocateAtLeast<Alloc>());
+    MPC_SV_TRY { detail::relocateRange(begin(), end(), temp); }
+    MPC_SV_CATCH_ALL {
+      allocTraits::deallocate(getAllocator(), temp, inp);
+      MPC_SV_RETHROW;
     }
-    if (chckSize > m_alloc) {
-      try {
-        reserve(m_alloc * 2);
-      } catch (std::exception &e) {
-        throw;
-      }
+    // Elements are already destroyed by the relocation
+    bool spill = !onHeap();
+    if (spill)
+      saveInlineCap(m_alloc);
+    else
+      allocTraits::deallocate(getAllocator(), m_data, m_alloc);
+    m_data = temp;
+    m_alloc = static_cast<uint32_t>(inp);
+    noteAlloc(spill);
+  }
+
+  // Statistics hooks, empty unless MPC_SV_STATS
+
+  // Called before the size goes down, so the peak is never missed
+  void notePeak() noexcept {
+#if MPC_SV_STATS
+    if (m_size > m_peak) m_peak = m_size;
+#endif
+  }
+
+  void noteAlloc(bool spill) noexcept {
+#if MPC_SV_STATS
+    if (!m_stats) return;
+    if (spill)
+      m_stats->spill(size_t(m_alloc) * sizeof(T));
+    else
+      m_stats->growth(size_t(m_alloc) * sizeof(T));
+#else
+    (void)spill;
+#endif
+  }
+
+  T *allocateBlock(size_t &inp, std::false_type) {
+    return allocTraits::allocate(getAllocator(), inp);
+  }
+
+  // Counts the slack the allocator reports as capacity
+  T *allocateBlock(size_t &inp, std::true_type) {
+    allocationResult<T *> res = getAllocator().allocate_at_least(inp);
+    inp = std::min<size_t>(res.count, UINT32_MAX);
+    return res.ptr;
+  }
+
+  // The derived smallVector puts its buffer at the first suitably aligned
+  // address after this header
+  static constexpr size_t inlineOffset() {
+    return (sizeof(smallVectorBase) + inlineAlign - 1) / inlineAlign *
+           inlineAlign;
+  }
+
+  T *inlineBegin() noexcept {
+    return reinterpret_cast<T *>(reinterpret_cast<char *>(this) +
+                                 inlineOffset());
+  }
+
+  const T *inlineBegin() const noexcept {
+    return reinterpret_cast<const T *>(reinterpret_cast<const char *>(this) +
+                                       inlineOffset());
+  }
+
+  bool onHeap() const noexcept { return m_data != inlineBegin(); }
+
+  // While on the heap the inline buffer is dead and holds N instead, so the
+  // base can go back inline without knowing it
+  void saveInlineCap(uint32_t cap) noexcept {
+    std::memcpy(static_cast<void *>(inlineBegin()), &cap, sizeof(cap));
+  }
+
+  uint32_t savedInlineCap() const noexcept {
+    uint32_t cap;
+    std::memcpy(&cap, static_cast<const void *>(inlineBegin()), sizeof(cap));
+    return cap;
+  }
+
+  // Move op = when the heap block may change owner
+  void moveAssign(smallVectorBase &other, std::true_type) {
+    if (other.onHeap() || !(getAllocator() == other.getAllocator()))
+      nearlyDestroy();
+    else
+      clear();
+    if (allocTraits::propagate_on_container_move_assignment::value)
+      getAllocator() = std::move(other.getAllocator());
+    takeFrom(other);
+  }
+
+  // Move op = with an allocator that stays put
+  void moveAssign(smallVectorBase &other, std::false_type) {
+    if (getAllocator() == other.getAllocator())
+      return moveAssign(other, std::true_type());
+    clear();
+    moveElementsFrom(other);
+  }
+
+  void swapElements(smallVectorBase &other) {
+    if (!onHeap() && !other.onHeap()) {
+      // The side whose elements do not fit over there moves as a block
+      if (m_size > other.m_alloc)
+        moveToHeap(m_size);
+      else if (other.m_size > m_alloc)
+        other.moveToHeap(other.m_size);
+      else
+        return swapInline(other, isTriviallyRelocatable<T>());
+    }
+    if (onHeap() && other.onHeap()) {
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+      std::swap(m_alloc, other.m_alloc);
+    } else {
+      swapMixed(onHeap() ? *this : other, onHeap() ? other : *this);
+    }
+  }
+
+  // Both inline and fitting in each other's buffer, bitwise
+  void swapInline(smallVectorBase &other, std::true_type) noexcept {
+    smallVectorBase &longer = m_size < other.m_size ? other : *this;
+    smallVectorBase &shorter = m_size < other.m_size ? *this : other;
+    char *a = reinterpret_cast<char *>(shorter.inlineBegin());
+    char *b = reinterpret_cast<char *>(longer.inlineBegin());
+    size_t common = shorter.m_size * sizeof(T);
+    std::swap_ranges(a, a + common, b);
+    std::memcpy(a + common, b + common, longer.m_size * sizeof(T) - common);
+    std::swap(m_size, other.m_size);
+  }
+
+  // Both inline: swap the common prefix, move over the rest
+  void swapInline(smallVectorBase &other, std::false_type) {
+    smallVectorBase &longer = m_size < other.m_size ? other : *this;
+    smallVectorBase &shorter = m_size < other.m_size ? *this : other;
+    size_t common = shorter.m_size;
+    for (size_t i = 0; i < common; i++) std::swap((*this)[i], other[i]);
+    for (size_t i = common; i < longer.m_size; i++) {
+      new (shorter.inlineBegin() + i) T(std::move(longer[i]));
+      longer[i].~T();
     }
+    std::swap(m_size, other.m_size);
   }
 
-  // Near Destructor
+  // One inline, one on heap: the heap block changes owner and the inline
+  // elements are relocated into the other object's buffer
+  static void swapMixed(smallVectorBase &heap, smallVectorBase &inl) {
+    uint32_t heapInline = heap.savedInlineCap();
+    if (inl.m_size > heapInline) {
+      inl.moveToHeap(inl.m_size);
+      std::swap(heap.m_data, inl.m_data);
+      std::swap(heap.m_size, inl.m_size);
+      std::swap(heap.m_alloc, inl.m_alloc);
+      return;
+    }
+    MPC_SV_TRY {
+      detail::relocateRange(inl.begin(), inl.end(), heap.inlineBegin());
+    }
+    MPC_SV_CATCH_ALL {
+      heap.saveInlineCap(heapInline);
+      MPC_SV_RETHROW;
+    }
+    T *block = heap.m_data;
+    uint32_t blockSize = heap.m_size;
+    uint32_t blockAlloc = heap.m_alloc;
+    heap.m_data = heap.inlineBegin();
+    heap.m_size = inl.m_size;
+    heap.m_alloc = heapInline;
+    inl.saveInlineCap(inl.m_alloc);
+    inl.m_data = block;
+    inl.m_size = blockSize;
+    inl.m_alloc = blockAlloc;
+  }
+
+  // Near Destructor, back to empty and inline
   void nearlyDestroy() noexcept {
     clear();
-    if (m_alloc) ::operator delete(m_data);
-    m_alloc = 0;
-    m_size = 0;
+    if (!onHeap()) return;
+    uint32_t inlineCap = savedInlineCap();
+    freeHeap();
+    m_data = inlineBegin();
+    m_alloc = inlineCap;
+  }
+
+  void freeHeap() noexcept {
+    if (onHeap()) allocTraits::deallocate(getAllocator(), m_data, m_alloc);
+  }
+
+};  // class small vector base
+
+// smallVector with N elements of inline storage; everything but
+// construction lives in smallVectorBase
+template <typename T, size_t N = 8, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+class smallVector : public smallVectorBase<T, Alloc, Growth> {
+  static_assert(N <= UINT32_MAX, "inline capacity must fit in 32 bits");
+
+  typedef smallVectorBase<T, Alloc, Growth> base;
+  typedef std::allocator_traits<Alloc> allocTraits;
+
+  // Also keeps N while on the heap, see smallVectorBase::saveInlineCap
+  static const size_t buffSize =
+      sizeof(T) * N > sizeof(uint32_t) ? sizeof(T) * N : sizeof(uint32_t);
+
+  // Member variables
+  alignas(base::inlineAlign) char m_buff[buffSize];
+
+ public:
+  //====================Ctors and Dtors====================
+
+  // Default constructor
+  smallVector() : smallVector(Alloc()) {}
+
+  // Empty vector spilling into alloc
+  explicit smallVector(const Alloc &alloc) : base(N, alloc) {
+    assert(static_cast<void *>(m_buff) == this->inlineBegin());
+#if MPC_SV_STATS
+    this->m_stats = &stats();
+#endif
+  }
+
+  // Constructor with given size
+  smallVector(const size_t sz, const Alloc &alloc = Alloc())
+      : smallVector(alloc) {
+    this->resize(sz);
+  }
+
+  // Copy constructor
+  smallVector(const smallVector &other)
+      : smallVector(other, allocTraits::select_on_container_copy_construction(
+                               other.getAllocator())) {}
+
+  // Copy constructor with allocator
+  smallVector(const base &other, const Alloc &alloc) : smallVector(alloc) {
+    this->reserve(other.size());
+    this->append(other.begin(), other.end());
+  }
+
+  // Copy of a vector with another inline capacity
+  explicit smallVector(const base &other)
+      : smallVector(other, allocTraits::select_on_container_copy_construction(
+                               other.get_allocator())) {}
+
+  // Range constructor
+  template <typename It, typename = detail::requireIter<It>>
+  smallVector(It first, It last, const Alloc &alloc = Alloc())
+      : smallVector(alloc) {
+    this->append(first, last);
+  }
+
+  // Move constructor
+  smallVector(smallVector &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value)
+      : smallVector(other.getAllocator()) {
+    this->takeFrom(other);
+  }
+
+  // Move of a vector with another inline capacity, its heap block is taken
+  // over as is
+  explicit smallVector(base &&other) : smallVector(other.get_allocator()) {
+    this->takeFrom(other);
+  }
+
+  // Move constructor with allocator, moves elements one by one when the
+  // heap block cannot be handed over
+  smallVector(base &&other, const Alloc &alloc) : smallVector(alloc) {
+    if (other.getAlloc() && !(alloc == other.get_allocator()))
+      this->moveElementsFrom(other);
+    else
+      this->takeFrom(other);
+  }
+
+  // Takes ownership of a block released by a vector with an equal
+  // allocator, without touching the elements
+  explicit smallVector(releasedBuffer<T> buf, const Alloc &alloc = Alloc())
+      : smallVector(alloc) {
+    this->adopt(buf);
+  }
+
+  // Conversion constructor
+  smallVector(std::initializer_list<T> init, const Alloc &alloc = Alloc())
+      : smallVector(alloc) {
+    this->append(init.begin(), init.end());
+  }
+
+  //___________________________Operators_______________________________
+
+  // Copy op =
+  smallVector &operator=(const smallVector &other) {
+    base::operator=(other);
+    return *this;
+  }
+
+  smallVector &operator=(const base &other) {
+    base::operator=(other);
+    return *this;
+  }
+
+  // Move op =
+  smallVector &operator=(smallVector &&other) noexcept(
+      base::moveStealsHeap::value &&
+      std::is_nothrow_move_constructible<T>::value) {
+    base::operator=(std::move(other));
+    return *this;
+  }
+
+  smallVector &operator=(base &&other) {
+    base::operator=(std::move(other));
+    return *this;
   }
 
+  //___________________________Misc_______________________________
+
+  using base::swap;
+
+  // Same N never allocates
+  void swap(smallVector &other) noexcept(
+      std::is_nothrow_move_constructible<T>::value) {
+    base::swap(other);
+  }
+
+#if MPC_SV_STATS
+  // Counters shared by every vector of this instantiation
+  static smallVectorStats &stats() {
+    static smallVectorStats s(typeid(smallVector), sizeof(T), N);
+    return s;
+  }
+#endif
+
 };  // class small vector
 
+// Destructive interference size of current x86 and ARM cores
+static const size_t cacheLineSize = 64;
+
+// smallVector on a cache line of its own: sizeof and alignof round up to
+// cacheLineSize, so neighbours in an array never false-share. Arrays of it
+// on the heap need C++17 aligned new (or an aligned allocator).
+template <typename T, size_t N = 8, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+class alignas(cacheLineSize) paddedSmallVector
+    : public smallVector<T, N, Alloc, Growth> {
+  typedef smallVector<T, N, Alloc, Growth> vec;
+
+ public:
+  paddedSmallVector() = default;
+  using vec::vec;
+  using vec::operator=;
+};
+
+//====================Capacity selection====================
+
+namespace detail {
+
+// Walks down from the estimate N to the first that fits in Bytes
+template <typename T, size_t Bytes, typename Alloc, typename Growth, size_t N,
+          bool = N == 0 || sizeof(smallVector<T, N, Alloc, Growth>) <= Bytes>
+struct fitInline : fitInline<T, Bytes, Alloc, Growth, N - 1> {};
+
+template <typename T, size_t Bytes, typename Alloc, typename Growth, size_t N>
+struct fitInline<T, Bytes, Alloc, Growth, N, true>
+    : std::integral_constant<size_t, N> {};
+
+}  // namespace detail
+
+// Largest N with sizeof(smallVector<T, N, Alloc, Growth>) <= Bytes, header,
+// alignment padding and stats fields included
+template <typename T, size_t Bytes, typename Alloc = std::allocator<T>,
+          typename Growth = growDouble>
+struct bytesCapacity
+    : detail::fitInline<
+          T, Bytes, Alloc, Growth,
+          (Bytes > sizeof(smallVectorBase<T, Alloc, Growth>)
+               ? (Bytes - sizeof(smallVectorBase<T, Alloc, Growth>)) /
+                     sizeof(T)
+               : 0)> {
+  static_assert(sizeof(smallVector<T, 0, Alloc, Growth>) <= Bytes,
+                "Bytes is below the size of an empty smallVector");
+};
+
+// smallVector with as many inline elements as fit in Bytes, e.g.
+// smallVectorBytes<int> is one cache line
+template <typename T, size_t Bytes = cacheLineSize,
+          typename Alloc = std::allocator<T>, typename Growth = growDouble>
+using smallVectorBytes =
+    smallVector<T, bytesCapacity<T, Bytes, Alloc, Growth>::value, Alloc,
+                Growth>;
+
+// Layout and fast paths of a smallVector type, for static_asserts next to
+// the declarations that pick N
+template <typename V>
+struct smallVectorTraits;
+
+template <typename T, size_t N, typename Alloc, typename Growth>
+struct smallVectorTraits<smallVector<T, N, Alloc, Growth>> {
+  typedef T value_type;
+  static const size_t inlineCapacity = N;
+  static const size_t objectSize = sizeof(smallVector<T, N, Alloc, Growth>);
+  // Bytes spent besides the inline elements
+  static const size_t overhead = objectSize - N * sizeof(T);
+  static const size_t cacheLines =
+      (objectSize + cacheLineSize - 1) / cacheLineSize;
+  // Growth, moves and swaps memcpy the elements
+  static const bool trivialRelocate = isTriviallyRelocatable<T>::value;
+  // Copies memcpy the elements
+  static const bool trivialCopy = std::is_trivially_copyable<T>::value;
+  // clear() and the destructor skip the element loop
+  static const bool trivialDestroy = std::is_trivially_destructible<T>::value;
+  // Heap growth may extend the block in place through Alloc::reallocate
+  static const bool inPlaceGrowth =
+      trivialRelocate && detail::hasReallocate<Alloc>::value;
+};
+
 // outside swap function
-template <typename T, size_t N>
-void swap(smallVector<T, N> &avec, smallVector<T, N> &bvec) noexcept {
+template <typename T, size_t N, typename Alloc, typename Growth>
+void swap(smallVector<T, N, Alloc, Growth> &avec,
+          smallVector<T, N, Alloc, Growth> &bvec) noexcept(
+    noexcept(avec.swap(bvec))) {
+  avec.swap(bvec);
+}
+
+template <typename T, typename Alloc, typename Growth>
+void swap(smallVectorBase<T, Alloc, Growth> &avec,
+          smallVectorBase<T, Alloc, Growth> &bvec) {
   avec.swap(bvec);
 }
 
+// Erases every element matching pred, returns how many were erased
+template <typename T, typename Alloc, typename Growth, typename Pred>
+size_t erase_if(smallVectorBase<T, Alloc, Growth> &vec, Pred pred) {
+  typename smallVectorBase<T, Alloc, Growth>::iterator it =
+      std::remove_if(vec.begin(), vec.end(), pred);
+  size_t n = vec.end() - it;
+  vec.erase(it, vec.end());
+  return n;
+}
+
 }  // namespace mpc
 
 #endif  // MPC_SMALLVECTOR
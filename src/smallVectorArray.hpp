@@ -0,0 +1,207 @@
+#ifndef MPC_SMALLVECTORARRAY
+#define MPC_SMALLVECTORARRAY
+
+// Many small rows in three flat arrays, e.g. adjacency lists or postings.
+// Row r keeps up to N elements in its slot of one contiguous slab; a row
+// that outgrows N moves into a block of a shared arena and is found through
+// an {offset, capacity} handle. A row that outgrows its block and is not at
+// the end of the arena moves to the end, the old block becomes garbage that
+// compact() reclaims. Everything is freed with the three arrays. T must be
+// trivially copyable, rows move with memcpy.
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "smallVector.hpp"
+#include "span.hpp"
+
+namespace mpc {
+
+template <typename T, size_t N = 4, typename Alloc = std::allocator<T>>
+class smallVectorArray {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "rows are moved with memcpy");
+
+  // Handle of a row, capacity 0 while the elements are in the slab
+  struct rowHandle {
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t offset;
+  };
+
+  typedef typename std::allocator_traits<Alloc>::template rebind_alloc<
+      rowHandle>
+      handleAlloc;
+
+  // Member variables
+  smallVector<rowHandle, 0, handleAlloc> m_rows;
+  smallVector<T, 0, Alloc> m_slab;
+  smallVector<T, 0, Alloc> m_arena;
+  size_t m_garbage;
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef span<T> row_type;
+  typedef span<const T> const_row_type;
+
+  //====================Ctors====================
+
+  smallVectorArray() : m_garbage(0) {}
+
+  // rows empty rows
+  explicit smallVectorArray(size_t rows) : smallVectorArray() { resize(rows); }
+
+  //___________________________Rows_______________________________
+
+  // Adds an empty row, returns its index
+  size_t add_row() {
+    resize(size() + 1);
+    return size() - 1;
+  }
+
+  // New rows are empty, the arena blocks of dropped rows become garbage
+  void resize(size_t rows) {
+    for (size_t r = rows; r < size(); r++) m_garbage += m_rows[r].capacity;
+    rowHandle empty = {0, 0, 0};
+    m_rows.resize(rows, empty);
+    m_slab.resize_for_overwrite(rows * N);
+  }
+
+  void reserve(size_t rows) {
+    m_rows.reserve(rows);
+    m_slab.reserve(rows * N);
+  }
+
+  // Drops every row and frees nothing
+  void clear() noexcept {
+    m_rows.clear();
+    m_slab.clear();
+    m_arena.clear();
+    m_garbage = 0;
+  }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  void push_back(size_t row, const T &inp) {
+    rowHandle &h = m_rows[row];
+    if (MPC_SV_UNLIKELY(h.size == capacity(h)))
+      return growAndPush(row, T(inp));
+    data(row)[h.size++] = inp;
+  }
+
+  void pop_back(size_t row) noexcept {
+    assert(m_rows[row].size);
+    m_rows[row].size--;
+  }
+
+  // The row keeps its block
+  void clear(size_t row) noexcept { m_rows[row].size = 0; }
+
+  // The elements of row, valid until the next push_back or compact()
+  row_type operator[](size_t row) noexcept {
+    return row_type(data(row), m_rows[row].size);
+  }
+
+  const_row_type operator[](size_t row) const noexcept {
+    return const_row_type(data(row), m_rows[row].size);
+  }
+
+  // Moves the live arena blocks to the front of a fresh arena in row order,
+  // exact fit. Rows of N elements or fewer go back to the slab.
+  void compact() {
+    size_t live = 0;
+    for (size_t r = 0; r < size(); r++)
+      if (m_rows[r].capacity && m_rows[r].size > N) live += m_rows[r].size;
+    if (live > UINT32_MAX) detail::throwLengthError("smallVectorArray");
+    smallVector<T, 0, Alloc> arena(m_arena.get_allocator());
+    arena.resize_for_overwrite(live);
+    size_t offset = 0;
+    for (size_t r = 0; r < size(); r++) {
+      rowHandle &h = m_rows[r];
+      if (!h.capacity) continue;
+      T *dest = h.size > N ? arena.data() + offset : m_slab.data() + r * N;
+      copyElements(dest, m_arena.data() + h.offset, h.size);
+      if (h.size > N) {
+        h.offset = static_cast<uint32_t>(offset);
+        h.capacity = h.size;
+        offset += h.size;
+      } else {
+        h.offset = 0;
+        h.capacity = 0;
+      }
+    }
+    m_arena.swap(arena);
+    m_garbage = 0;
+  }
+
+  //___________________________Getters_______________________________
+
+  // Number of rows
+  size_t size() const noexcept { return m_rows.size(); }
+
+  bool empty() const noexcept { return m_rows.empty(); }
+
+  size_t row_size(size_t row) const noexcept { return m_rows[row].size; }
+
+  // Elements of the arena, live or not
+  size_t arena_size() const noexcept { return m_arena.size(); }
+
+  // Arena elements no row uses any more
+  size_t garbage() const noexcept { return m_garbage; }
+
+  //___________________________Private func_______________________________
+
+ private:
+  static size_t capacity(const rowHandle &h) noexcept {
+    return h.capacity ? h.capacity : N;
+  }
+
+  T *data(size_t row) noexcept {
+    const rowHandle &h = m_rows[row];
+    return h.capacity ? m_arena.data() + h.offset : m_slab.data() + row * N;
+  }
+
+  const T *data(size_t row) const noexcept {
+    const rowHandle &h = m_rows[row];
+    return h.capacity ? m_arena.data() + h.offset : m_slab.data() + row * N;
+  }
+
+  static void copyElements(T *dest, const T *src, size_t n) noexcept {
+    if (n)
+      std::memcpy(static_cast<void *>(dest), static_cast<const void *>(src),
+                  n * sizeof(T));
+  }
+
+  // The row doubles. A block at the end of the arena grows in place,
+  // others move to the end. inp is a copy, the arena may reallocate.
+  MPC_SV_COLD void growAndPush(size_t row, T inp) {
+    rowHandle &h = m_rows[row];
+    size_t cap = capacity(h);
+    size_t newCap = cap ? cap * 2 : 1;
+    if (h.capacity && h.offset + h.capacity == m_arena.size()) {
+      if (m_arena.size() + cap > UINT32_MAX)
+        detail::throwLengthError("smallVectorArray");
+      m_arena.resize_for_overwrite(m_arena.size() + cap);
+    } else {
+      size_t offset = m_arena.size();
+      if (offset + newCap > UINT32_MAX)
+        detail::throwLengthError("smallVectorArray");
+      m_arena.resize_for_overwrite(offset + newCap);
+      copyElements(m_arena.data() + offset, data(row), h.size);
+      m_garbage += h.capacity;
+      h.offset = static_cast<uint32_t>(offset);
+    }
+    h.capacity = static_cast<uint32_t>(newCap);
+    m_arena[h.offset + h.size++] = inp;
+  }
+};
+
+}  // namespace mpc
+
+#endif  // MPC_SMALLVECTORARRAY
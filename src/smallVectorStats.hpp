@@ -0,0 +1,177 @@
+#ifndef MPC_SMALLVECTORSTATS
+#define MPC_SMALLVECTORSTATS
+
+// Per instantiation statistics for capacity tuning. Only compiled in when
+// MPC_SV_STATS is defined to 1 before including smallVector.hpp.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace mpc {
+
+// Counters of one smallVector<T, N, Alloc, Growth> instantiation
+class smallVectorStats {
+ public:
+  // Peak sizes 0..63 are counted exactly, larger ones per power of two
+  static const size_t exactBuckets = 64;
+  static const size_t buckets = exactBuckets + 27;
+
+  smallVectorStats(const std::type_info &type, size_t elemSize,
+                   size_t inlineCap)
+      : m_name(demangle(type.name())),
+        m_elemSize(elemSize),
+        m_inlineCap(inlineCap),
+        m_next(nullptr) {
+    reset();
+    link();
+  }
+
+  smallVectorStats(const smallVectorStats &) = delete;
+  smallVectorStats &operator=(const smallVectorStats &) = delete;
+
+  //___________________________Recording_______________________________
+
+  // Inline buffer to heap
+  void spill(size_t bytes) noexcept {
+    m_spills.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  // Heap to bigger heap
+  void growth(size_t bytes) noexcept {
+    m_growths.fetch_add(1, std::memory_order_relaxed);
+    m_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  // A vector died with the given peak size
+  void peak(size_t size) noexcept {
+    m_objects.fetch_add(1, std::memory_order_relaxed);
+    m_hist[bucket(size)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  //___________________________Getters_______________________________
+
+  const std::string &name() const noexcept { return m_name; }
+  size_t elemSize() const noexcept { return m_elemSize; }
+  size_t inlineCapacity() const noexcept { return m_inlineCap; }
+  uint64_t objects() const noexcept { return load(m_objects); }
+  uint64_t spills() const noexcept { return load(m_spills); }
+  uint64_t growths() const noexcept { return load(m_growths); }
+  uint64_t bytesAllocated() const noexcept { return load(m_bytes); }
+  uint64_t histogram(size_t b) const noexcept { return load(m_hist[b]); }
+
+  // Largest size counted in bucket b
+  static uint64_t bucketLimit(size_t b) noexcept {
+    if (b < exactBuckets) return b;
+    return (uint64_t(exactBuckets) << (b - exactBuckets + 1)) - 1;
+  }
+
+  // Smallest size that covers fraction p of the recorded peaks, e.g.
+  // percentile(0.95) is the N that keeps 95% of the vectors inline
+  uint64_t percentile(double p) const noexcept {
+    uint64_t total = objects();
+    if (!total) return 0;
+    uint64_t want = static_cast<uint64_t>(p * total + 0.5);
+    if (want == 0) want = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets; b++) {
+      seen += histogram(b);
+      if (seen >= want) return bucketLimit(b);
+    }
+    return bucketLimit(buckets - 1);
+  }
+
+  void reset() noexcept {
+    m_objects.store(0, std::memory_order_relaxed);
+    m_spills.store(0, std::memory_order_relaxed);
+    m_growths.store(0, std::memory_order_relaxed);
+    m_bytes.store(0, std::memory_order_relaxed);
+    for (size_t b = 0; b < buckets; b++)
+      m_hist[b].store(0, std::memory_order_relaxed);
+  }
+
+  //___________________________Registry_______________________________
+
+  // Every instantiation that has been used so far
+  static smallVectorStats *first() noexcept {
+    return head().load(std::memory_order_acquire);
+  }
+
+  smallVectorStats *next() const noexcept { return m_next; }
+
+  // One line per instantiation
+  static void dump(std::ostream &os) {
+    for (smallVectorStats *s = first(); s; s = s->next()) {
+      os << s->name() << ": objects=" << s->objects()
+         << " spills=" << s->spills() << " growths=" << s->growths()
+         << " bytes=" << s->bytesAllocated() << " N=" << s->inlineCapacity()
+         << " p50=" << s->percentile(0.50) << " p95=" << s->percentile(0.95)
+         << " p99=" << s->percentile(0.99) << '\n';
+    }
+  }
+
+  static void resetAll() noexcept {
+    for (smallVectorStats *s = first(); s; s = s->next()) s->reset();
+  }
+
+ private:
+  std::string m_name;
+  size_t m_elemSize;
+  size_t m_inlineCap;
+  smallVectorStats *m_next;
+  std::atomic<uint64_t> m_objects;
+  std::atomic<uint64_t> m_spills;
+  std::atomic<uint64_t> m_growths;
+  std::atomic<uint64_t> m_bytes;
+  std::atomic<uint64_t> m_hist[buckets];
+
+  static std::atomic<smallVectorStats *> &head() noexcept {
+    static std::atomic<smallVectorStats *> h(nullptr);
+    return h;
+  }
+
+  static uint64_t load(const std::atomic<uint64_t> &a) noexcept {
+    return a.load(std::memory_order_relaxed);
+  }
+
+  static size_t bucket(size_t size) noexcept {
+    if (size < exactBuckets) return size;
+    size_t b = exactBuckets;
+    for (size_t s = size / exactBuckets; s > 1 && b < buckets - 1; s /= 2) b++;
+    return b;
+  }
+
+  void link() noexcept {
+    smallVectorStats *h = head().load(std::memory_order_relaxed);
+    do {
+      m_next = h;
+    } while (!head().compare_exchange_weak(h, this, std::memory_order_release,
+                                           std::memory_order_relaxed));
+  }
+
+  static std::string demangle(const char *name) {
+#if defined(__GNUG__)
+    int status = 0;
+    char *res = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+    if (status == 0 && res) {
+      std::string out(res);
+      std::free(res);
+      return out;
+    }
+#endif
+    return name;
+  }
+};
+
+}  // namespace mpc
+
+#endif  // MPC_SMALLVECTORSTATS
@@ -0,0 +1,143 @@
+#ifndef MPC_SPAN
+#define MPC_SPAN
+
+// Non-owning view of contiguous elements, a C++11 take on std::span with a
+// dynamic extent only. Hot functions take span<const T> instead of a
+// smallVector of some N or a std::vector, and nothing gets copied.
+
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace mpc {
+
+// subspan() count meaning "up to the end"
+static const size_t dynamic_extent = size_t(-1);
+
+namespace detail {
+
+// C has data() and size(), and its element pointer converts to T *
+// (e.g. int * to const int *, but not derived to base)
+template <typename C, typename T, typename = void>
+struct isSpanSource : std::false_type {};
+
+template <typename C, typename T>
+struct isSpanSource<
+    C, T,
+    typename std::enable_if<
+        std::is_convertible<
+            typename std::remove_pointer<decltype(
+                std::declval<C &>().data())>::type (*)[],
+            T (*)[]>::value &&
+        std::is_convertible<decltype(std::declval<C &>().size()),
+                            size_t>::value>::type> : std::true_type {};
+
+}  // namespace detail
+
+template <typename T>
+class span {
+  // Member variables
+  T *m_data;
+  size_t m_size;
+
+ public:
+  // Public member types
+  typedef T element_type;
+  typedef typename std::remove_cv<T>::type value_type;
+  typedef T &reference;
+  typedef T *pointer;
+  typedef T *iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
+
+  //====================Ctors====================
+
+  constexpr span() noexcept : m_data(nullptr), m_size(0) {}
+
+  constexpr span(T *data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+  constexpr span(T *first, T *last) noexcept
+      : m_data(first), m_size(last - first) {}
+
+  template <size_t K>
+  constexpr span(T (&arr)[K]) noexcept : m_data(arr), m_size(K) {}
+
+  // Any contiguous container: smallVector of any N, smallVectorBase,
+  // std::vector, std::array, span<U>. The view is only valid as long as the
+  // container is not resized.
+  template <typename C,
+            typename = typename std::enable_if<
+                detail::isSpanSource<C, T>::value>::type>
+  span(C &c) noexcept : m_data(c.data()), m_size(c.size()) {}
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() const noexcept { return m_data; }
+
+  iterator end() const noexcept { return m_data + m_size; }
+
+  reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+
+  reverse_iterator rend() const noexcept { return reverse_iterator(begin()); }
+
+  //___________________________Getters_______________________________
+
+  constexpr size_t size() const noexcept { return m_size; }
+
+  constexpr size_t size_bytes() const noexcept { return m_size * sizeof(T); }
+
+  constexpr bool empty() const noexcept { return m_size == 0; }
+
+  constexpr pointer data() const noexcept { return m_data; }
+
+  reference operator[](size_t ind) const {
+    assert(ind < m_size);
+    return m_data[ind];
+  }
+
+  reference front() const { return (*this)[0]; }
+
+  reference back() const { return (*this)[m_size - 1]; }
+
+  //___________________________Slicing_______________________________
+
+  // First n elements
+  span first(size_t n) const {
+    assert(n <= m_size);
+    return span(m_data, n);
+  }
+
+  // Last n elements
+  span last(size_t n) const {
+    assert(n <= m_size);
+    return span(m_data + m_size - n, n);
+  }
+
+  // count elements from offset, everything past offset by default
+  span subspan(size_t offset, size_t count = dynamic_extent) const {
+    assert(offset <= m_size);
+    if (count == dynamic_extent) count = m_size - offset;
+    assert(count <= m_size - offset);
+    return span(m_data + offset, count);
+  }
+
+  //___________________________Conversion_______________________________
+
+  // Copy into a new std::vector, other containers take begin()/end()
+  std::vector<value_type> toVector() const {
+    return std::vector<value_type>(begin(), end());
+  }
+};
+
+// Read-only view of c
+template <typename C>
+span<const typename std::remove_pointer<decltype(
+    std::declval<const C &>().data())>::type>
+makeSpan(const C &c) noexcept {
+  return {c.data(), c.size()};
+}
+
+}  // namespace mpc
+
+#endif  // MPC_SPAN
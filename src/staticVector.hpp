@@ -0,0 +1,392 @@
+#ifndef MPC_STATICVECTOR
+#define MPC_STATICVECTOR
+
+// Fixed capacity vector that never allocates: the object is the inline
+// buffer plus the smallest size counter that holds N. Copies are plain
+// memcpys (trivially copyable) when T is trivially copyable. The API is
+// smallVector's minus the heap; insert, append and erase are the
+// detail::vectorOps that smallVectorBase runs, with a full vector reported
+// where smallVector would grow.
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "smallVector.hpp"
+
+namespace mpc {
+
+namespace detail {
+
+template <size_t N>
+using staticSizeType = typename std::conditional<
+    N <= UINT8_MAX, uint8_t,
+    typename std::conditional<N <= UINT16_MAX, uint16_t,
+                              uint32_t>::type>::type;
+
+// Storage of staticVector. This one leaves every special member implicit,
+// so they are trivial and copies take the whole buffer.
+template <typename T, size_t N, bool = std::is_trivially_copyable<T>::value>
+struct staticStorage {
+  staticSizeType<N> m_size;
+  alignas(alignof(T)) char m_buff[N ? sizeof(T) * N : 1];
+
+  staticStorage() noexcept : m_size(0) {}
+
+  T *ptr() noexcept { return reinterpret_cast<T *>(m_buff); }
+  const T *ptr() const noexcept { return reinterpret_cast<const T *>(m_buff); }
+};
+
+// Elementwise copies and moves for the other types, a moved-from vector
+// keeps its (moved-from) elements
+template <typename T, size_t N>
+struct staticStorage<T, N, false> {
+  staticSizeType<N> m_size;
+  alignas(alignof(T)) char m_buff[N ? sizeof(T) * N : 1];
+
+  staticStorage() noexcept : m_size(0) {}
+
+  staticStorage(const staticStorage &other) : m_size(0) {
+    copyRange(other.ptr(), other.ptr() + other.m_size, ptr());
+    m_size = other.m_size;
+  }
+
+  // A move that throws destroys the elements already moved, the destructor
+  // does not run for a constructor that throws
+  staticStorage(staticStorage &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value)
+      : m_size(0) {
+    copyRange(std::make_move_iterator(other.ptr()),
+              std::make_move_iterator(other.ptr() + other.m_size), ptr());
+    m_size = other.m_size;
+  }
+
+  staticStorage &operator=(const staticStorage &other) {
+    if (this != &other) assignFrom(other.ptr(), other.m_size);
+    return *this;
+  }
+
+  staticStorage &operator=(staticStorage &&other) noexcept(
+      std::is_nothrow_move_constructible<T>::value &&
+      std::is_nothrow_move_assignable<T>::value) {
+    if (this != &other)
+      assignFrom(std::make_move_iterator(other.ptr()), other.m_size);
+    return *this;
+  }
+
+  ~staticStorage() { destroyRange(ptr(), ptr() + m_size); }
+
+  T *ptr() noexcept { return reinterpret_cast<T *>(m_buff); }
+  const T *ptr() const noexcept { return reinterpret_cast<const T *>(m_buff); }
+
+  // Assigns over the common prefix, then constructs or destroys the rest
+  template <typename It>
+  void assignFrom(It src, size_t size) {
+    size_t common = std::min<size_t>(m_size, size);
+    std::copy(src, src + common, ptr());
+    if (size < m_size) {
+      destroyRange(ptr() + size, ptr() + m_size);
+      m_size = static_cast<staticSizeType<N>>(size);
+    }
+    for (; m_size < size; m_size++) new (ptr() + m_size) T(src[m_size]);
+  }
+};
+
+}  // namespace detail
+
+template <typename T, size_t N>
+class staticVector : private detail::staticStorage<T, N> {
+  static_assert(N <= UINT32_MAX, "capacity must fit in 32 bits");
+
+  typedef detail::staticStorage<T, N> storage;
+  typedef detail::staticSizeType<N> sizeType;
+
+  using storage::m_size;
+  using storage::ptr;
+
+  friend struct detail::vectorOps<staticVector>;
+  typedef detail::vectorOps<staticVector> ops;
+
+ public:
+  // Public member types
+  typedef T value_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+  typedef T *pointer;
+  typedef const T *const_pointer;
+  typedef T *iterator;
+  typedef const T *const_iterator;
+
+  //====================Ctors====================
+
+  staticVector() = default;
+
+  // size value-initialized elements
+  explicit staticVector(size_t size) { resize(size); }
+
+  staticVector(size_t n, const T &val) { append(n, val); }
+
+  // Range constructor
+  template <typename It, typename = detail::requireIter<It>>
+  staticVector(It first, It last) {
+    append(first, last);
+  }
+
+  staticVector(std::initializer_list<T> init) {
+    append(init.begin(), init.end());
+  }
+
+  //___________________________Element
+  // manipulation_______________________________
+
+  // Everything that adds elements reports an error through
+  // MPC_SV_ERROR_POLICY when they do not fit, the try_* members return false
+
+  void push_back(const T &inp) { emplace_back(inp); }
+
+  void push_back(T &&inp) { emplace_back(std::move(inp)); }
+
+  template <typename... Ts>
+  void emplace_back(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(full()))
+      detail::throwLengthError("staticVector::emplace_back");
+    new (end()) T(std::forward<Ts>(params)...);
+    m_size++;
+  }
+
+  bool try_push_back(const T &inp) { return try_emplace_back(inp); }
+
+  bool try_push_back(T &&inp) { return try_emplace_back(std::move(inp)); }
+
+  template <typename... Ts>
+  bool try_emplace_back(Ts &&...params) {
+    if (MPC_SV_UNLIKELY(full())) return false;
+    new (end()) T(std::forward<Ts>(params)...);
+    m_size++;
+    return true;
+  }
+
+  // Appends [first, last), checking the room once for forward ranges.
+  // The range must not point into this vector.
+  template <typename It, typename = detail::requireIter<It>>
+  void append(It first, It last) {
+    ops::appendRange(*this, first, last,
+                     typename std::iterator_traits<It>::iterator_category());
+  }
+
+  // Appends n copies of val, which may be an element: nothing moves
+  void append(size_t n, const T &val) { ops::appendFill(*this, n, val); }
+
+  void append(std::initializer_list<T> init) {
+    append(init.begin(), init.end());
+  }
+
+  // Appends n uninitialized elements and returns the first one
+  T *append_uninitialized(size_t n) {
+    static_assert(std::is_trivially_default_constructible<T>::value &&
+                      std::is_trivially_destructible<T>::value,
+                  "append_uninitialized needs a trivial T");
+    makeRoom(n);
+    T *res = end();
+    m_size += static_cast<sizeType>(n);
+    return res;
+  }
+
+  // Replaces the contents with [first, last)
+  template <typename It, typename = detail::requireIter<It>>
+  void assign(It first, It last) {
+    clear();
+    append(first, last);
+  }
+
+  void assign(size_t n, const T &val) {
+    clear();
+    append(n, val);
+  }
+
+  void assign(std::initializer_list<T> init) {
+    assign(init.begin(), init.end());
+  }
+
+  // Inserts [first, last) before pos, returns iterator to the first
+  // inserted element
+  template <typename It, typename = detail::requireIter<It>>
+  iterator insert(const_iterator pos, It first, It last) {
+    size_t index = pos - begin();
+    ops::insertRange(*this, index, first, last,
+                     typename std::iterator_traits<It>::iterator_category());
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, std::initializer_list<T> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  // Inserts n copies of val before pos
+  iterator insert(const_iterator pos, size_t n, const T &val) {
+    size_t index = pos - begin();
+    // val may live in this vector, copy it before anything moves
+    T copy(val);
+    ops::insertFill(*this, index, n, copy, isTriviallyRelocatable<T>());
+    return begin() + index;
+  }
+
+  iterator insert(const_iterator pos, const T &val) { return emplace(pos, val); }
+
+  iterator insert(const_iterator pos, T &&val) {
+    return emplace(pos, std::move(val));
+  }
+
+  // Constructs an element before pos
+  template <typename... Ts>
+  iterator emplace(const_iterator pos, Ts &&...params) {
+    size_t index = pos - begin();
+    if (index == m_size) {
+      emplace_back(std::forward<Ts>(params)...);
+      return end() - 1;
+    }
+    // params may refer to elements, build the value before shifting
+    T temp(std::forward<Ts>(params)...);
+    ops::emplaceShift(*this, index, temp, isTriviallyRelocatable<T>());
+    return begin() + index;
+  }
+
+  void pop_back() noexcept {
+    assert(m_size);
+    (end() - 1)->~T();
+    m_size--;
+  }
+
+  iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  // Erases [first, last), the tail is memmoved for trivially relocatable T
+  iterator erase(const_iterator first, const_iterator last) {
+    size_t index = first - begin();
+    size_t n = last - first;
+    if (n) ops::erase(*this, index, n);
+    return begin() + index;
+  }
+
+  // O(1) erase that moves the last element into pos, order is not kept
+  iterator unordered_erase(const_iterator pos) {
+    iterator it = begin() + (pos - begin());
+    ops::unorderedErase(*this, it);
+    return it;
+  }
+
+  // Reports an error past N, there is nothing to reserve otherwise
+  void reserve(size_t inp) const {
+    if (inp > N) detail::throwLengthError("staticVector::reserve");
+  }
+
+  bool try_reserve(size_t inp) const noexcept { return inp <= N; }
+
+  // New elements are value-initialized
+  void resize(size_t size) {
+    if (size <= m_size) return truncate(size);
+    reserve(size);
+    for (; m_size < size; m_size++) new (end()) T();
+  }
+
+  void resize(size_t size, const T &val) {
+    if (size <= m_size) return truncate(size);
+    reserve(size);
+    for (; m_size < size; m_size++) new (end()) T(val);
+  }
+
+  // New elements are default-initialized, i.e. left uninitialized for
+  // trivial T
+  void resize_for_overwrite(size_t size) {
+    if (size <= m_size) return truncate(size);
+    reserve(size);
+    for (; m_size < size; m_size++) new (end()) T;
+  }
+
+  void clear() noexcept { truncate(0); }
+
+  void swap(staticVector &other) noexcept(
+      std::is_nothrow_move_constructible<T>::value &&
+      std::is_nothrow_move_assignable<T>::value) {
+    std::swap(static_cast<storage &>(*this), static_cast<storage &>(other));
+  }
+
+  //___________________________Iterator_______________________________
+
+  iterator begin() noexcept { return ptr(); }
+
+  const_iterator begin() const noexcept { return ptr(); }
+
+  iterator end() noexcept { return ptr() + m_size; }
+
+  const_iterator end() const noexcept { return ptr() + m_size; }
+
+  //___________________________Getters_______________________________
+
+  reference operator[](size_t ind) { return ptr()[ind]; }
+
+  const_reference operator[](size_t ind) const { return ptr()[ind]; }
+
+  size_t size() const noexcept { return m_size; }
+
+  bool empty() const noexcept { return m_size == 0; }
+
+  bool full() const noexcept { return m_size == N; }
+
+  static constexpr size_t capacity() noexcept { return N; }
+
+  static constexpr size_t max_size() noexcept { return N; }
+
+  pointer data() noexcept { return ptr(); }
+
+  const_pointer data() const noexcept { return ptr(); }
+
+  reference front() { return *begin(); }
+
+  const_reference front() const { return *begin(); }
+
+  reference back() { return *(end() - 1); }
+
+  const_reference back() const { return *(end() - 1); }
+
+  //___________________________Private func_______________________________
+
+ private:
+  // vectorOps hooks
+  void makeRoom(size_t n) const {
+    if (n > N - m_size) detail::throwLengthError("staticVector: full");
+  }
+
+  void setSize(size_t size) noexcept { m_size = static_cast<sizeType>(size); }
+
+  // Destroys the elements past size
+  void truncate(size_t size) noexcept {
+    detail::destroyRange(begin() + size, end());
+    m_size = static_cast<sizeType>(size);
+  }
+};
+
+template <typename T, size_t N>
+void swap(staticVector<T, N> &avec,
+          staticVector<T, N> &bvec) noexcept(noexcept(avec.swap(bvec))) {
+  avec.swap(bvec);
+}
+
+// Erases every element matching pred, returns how many were erased
+template <typename T, size_t N, typename Pred>
+size_t erase_if(staticVector<T, N> &vec, Pred pred) {
+  typename staticVector<T, N>::iterator it =
+      std::remove_if(vec.begin(), vec.end(), pred);
+  size_t n = vec.end() - it;
+  vec.erase(it, vec.end());
+  return n;
+}
+
+}  // namespace mpc
+
+#endif  // MPC_STATICVECTOR
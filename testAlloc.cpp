@@ -0,0 +1,183 @@
+// Allocation counts of the key scenarios: global operator new and delete
+// are replaced with counting versions, every test asserts how many heap
+// blocks a sequence of operations takes and that all of them are freed.
+
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "src/compactVector.hpp"
+#include "src/sharedSmallVector.hpp"
+#include "src/smallDeque.hpp"
+#include "src/smallFlatSet.hpp"
+#include "src/smallString.hpp"
+#include "src/smallVector.hpp"
+
+static size_t g_news = 0;
+static size_t g_deletes = 0;
+
+void *operator new(size_t size) {
+  g_news++;
+  if (void *p = std::malloc(size ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  g_news++;
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) noexcept {
+  if (p) g_deletes++;
+  std::free(p);
+}
+
+void operator delete[](void *p) noexcept { operator delete(p); }
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+void operator delete[](void *p, size_t) noexcept { operator delete(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  operator delete(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  operator delete(p);
+}
+
+// operator new and delete calls since construction
+class allocCounter {
+  size_t m_news;
+  size_t m_deletes;
+
+ public:
+  allocCounter() : m_news(g_news), m_deletes(g_deletes) {}
+
+  size_t news() const { return g_news - m_news; }
+  size_t deletes() const { return g_deletes - m_deletes; }
+};
+
+// Filling, editing, copying and moving within N never allocates
+static void testInline() {
+  allocCounter count;
+  {
+    mpc::smallVector<int, 8> vec;
+    for (int i = 0; i < 8; i++) vec.push_back(i);
+    vec.erase(vec.begin());
+    vec.insert(vec.begin(), 42);
+    vec.resize(4);
+    vec.resize(8, 7);
+    mpc::smallVector<int, 8> copy(vec);
+    mpc::smallVector<int, 8> moved(std::move(copy));
+    moved.swap(vec);
+    vec = moved;
+    mpc::compactVector<int, 8> compact(vec.begin(), vec.end());
+    mpc::smallFlatSet<int, 8> set(vec.begin(), vec.end());
+    mpc::smallString<> key("session:");
+    key.append_int(1234567890123LL).append(":region-eu", 10);
+    assert(key.size() == 31 && key.c_str()[31] == '\0');
+    mpc::smallDeque<int, 8> fifo;
+    for (int i = 0; i < 100; i++) {
+      fifo.push_back(i);
+      if (fifo.size() == 8) fifo.pop_front();
+    }
+  }
+  assert(count.news() == 0 && count.deletes() == 0);
+}
+
+// One allocation per capacity change, one free per block left behind
+static void testGrowth() {
+  allocCounter count;
+  {
+    mpc::smallVector<int, 4> vec;
+    size_t steps = 0;
+    for (int i = 0; i < 1000; i++) {
+      size_t cap = vec.capacity();
+      vec.push_back(i);
+      if (vec.capacity() != cap) steps++;
+    }
+    assert(steps == 8 && count.news() == steps);
+    assert(count.deletes() == steps - 1);
+  }
+  assert(count.deletes() == count.news());
+
+  allocCounter reserved;
+  {
+    mpc::smallVector<int, 4> vec;
+    vec.reserve(1000);
+    for (int i = 0; i < 1000; i++) vec.push_back(i);
+    vec.shrink_to_fit();
+    assert(reserved.news() == 1);
+    vec.resize(2);
+    vec.shrink_to_fit();
+    assert(!vec.getAlloc() && reserved.deletes() == 1);
+  }
+  assert(reserved.news() == 1 && reserved.deletes() == 1);
+}
+
+// Moves and swaps of spilled vectors hand the block over
+static void testMoves() {
+  mpc::smallVector<int, 4> a(100);
+  mpc::smallVector<int, 4> b(50);
+  mpc::compactVector<int, 4> c(100);
+  mpc::smallDeque<int, 4> d(100);
+  allocCounter count;
+  {
+    mpc::smallVector<int, 4> moved(std::move(a));
+    a = std::move(moved);
+    a.swap(b);
+    mpc::compactVector<int, 4> compact(std::move(c));
+    c = std::move(compact);
+    mpc::smallDeque<int, 4> deque(std::move(d));
+    d = std::move(deque);
+  }
+  assert(count.news() == 0 && count.deletes() == 0);
+}
+
+// A deep copy takes one block, a shared one none until it is written
+static void testCopies() {
+  mpc::smallVector<int, 4> vec(100);
+  mpc::sharedSmallVector<int, 4> shared(100);
+  allocCounter count;
+  {
+    mpc::smallVector<int, 4> copy(vec);
+    assert(count.news() == 1);
+    mpc::sharedSmallVector<int, 4> first(shared);
+    mpc::sharedSmallVector<int, 4> second(first);
+    assert(count.news() == 1 && shared.use_count() == 3);
+    second.push_back(1);
+    assert(count.news() == 2 && shared.use_count() == 2);
+  }
+  assert(count.news() == 2 && count.deletes() == 2);
+
+  // Elements allocate on their own, the inline slots do not
+  allocCounter strings;
+  {
+    mpc::smallVector<std::string, 4> vec;
+    for (int i = 0; i < 4; i++) vec.emplace_back(100, 'x');
+    assert(strings.news() == 4);
+    mpc::smallVector<std::string, 4> moved(std::move(vec));
+    assert(strings.news() == 4);
+  }
+  assert(strings.deletes() == 4);
+}
+
+int main() {
+  std::cout << "Test Alloc start." << std::endl;
+  testInline();
+  testGrowth();
+  testMoves();
+  testCopies();
+  std::cout << "Test Alloc end." << std::endl;
+  return 0;
+}
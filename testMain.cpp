@@ -1,10 +1,1083 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "src/allocators.hpp"
+#include "src/compactVector.hpp"
+#include "src/concurrentSmallVector.hpp"
+#include "src/parallel.hpp"
+#include "src/serialize.hpp"
+#include "src/sharedSmallVector.hpp"
+#include "src/simd.hpp"
+#include "src/smallDeque.hpp"
+#include "src/smallFlatMap.hpp"
+#include "src/smallFlatSet.hpp"
+#include "src/smallSoaVector.hpp"
+#include "src/smallString.hpp"
 #include "src/smallVector.hpp"
+#include "src/smallVectorArray.hpp"
+#include "src/span.hpp"
+#include "src/staticVector.hpp"
+
+// Header is one pointer plus packed 32-bit size/capacity, the statistics
+// build adds the stats pointer and the peak size
+static const size_t svHeader =
+    sizeof(void *) + 2 * sizeof(uint32_t) +
+    (MPC_SV_STATS ? sizeof(void *) + sizeof(size_t) : 0);
+
+static void testLayout() {
+  static_assert(sizeof(mpc::smallVector<int, 8>) == svHeader + 8 * sizeof(int),
+                "unexpected smallVector header size");
+
+  mpc::smallVector<std::string, 2> a;
+  a.push_back("one");
+  a.push_back("two");
+  mpc::smallVector<std::string, 2> b(std::move(a));
+  assert(a.size() == 0 && b.size() == 2 && b[1] == "two");
+  assert(b.data() != a.data());
+
+  b.push_back("three");
+  assert(b.getAlloc() == 4);
+  mpc::smallVector<std::string, 2> c;
+  c.push_back("inline");
+  c.swap(b);
+  assert(c.size() == 3 && b.size() == 1 && b[0] == "inline");
+  assert(b.getAlloc() == 0 && c.getAlloc() == 4);
+}
+
+// Owning pointer that opts into the bitwise relocation path
+struct relocBox {
+  std::unique_ptr<int> p;
+  explicit relocBox(int v) : p(new int(v)) {}
+};
+
+namespace mpc {
+template <>
+struct isTriviallyRelocatable<relocBox> : std::true_type {};
+}  // namespace mpc
+
+static void testTrivialPaths() {
+  mpc::smallVector<relocBox, 2> a;
+  for (int i = 0; i < 9; i++) a.emplace_back(i);
+  mpc::smallVector<relocBox, 2> b;
+  b.emplace_back(42);
+  mpc::smallVector<relocBox, 2> c;
+  c.swap(b);
+  assert(b.size() == 0 && *c[0].p == 42);
+  assert(*a[8].p == 8 && a.capacity() == 16);
+
+  mpc::smallVector<int, 4> ints{1, 2, 3};
+  mpc::smallVector<int, 4> copy(ints);
+  copy.clear();
+  assert(copy.size() == 0 && ints[2] == 3);
+}
+
+static void testAllocators() {
+  char buff[256];
+  mpc::arenaResource arena(buff, sizeof(buff));
+  mpc::arenaSmallVector<int, 2> a(&arena);
+  for (int i = 0; i < 20; i++) a.push_back(i);
+  assert(a[19] == 19 && a.get_allocator().arena() == &arena);
+
+  // Different arenas do not propagate, elements are moved instead
+  mpc::arenaResource other;
+  mpc::arenaSmallVector<int, 2> b(&other);
+  b = std::move(a);
+  assert(b.size() == 20 && b.get_allocator().arena() == &other);
+
+  mpc::pmr::smallVector<std::string, 1> p(&arena);
+  p.push_back("a");
+  p.push_back("b");
+  mpc::pmr::smallVector<std::string, 1> q(p);
+  assert(q.get_allocator().resource() == mpc::newDeleteResource());
+  assert(q[1] == "b");
+}
+
+// Stateful allocator that follows swaps and counts its live blocks
+template <typename T>
+struct swappingAllocator {
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_swap;
+  int *m_live;
+
+  swappingAllocator(int *live) noexcept : m_live(live) {}
+
+  template <typename U>
+  swappingAllocator(const swappingAllocator<U> &other) noexcept
+      : m_live(other.m_live) {}
+
+  T *allocate(size_t n) {
+    ++*m_live;
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T *p, size_t n) noexcept {
+    assert(*m_live > 0);
+    --*m_live;
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  bool operator==(const swappingAllocator &other) const noexcept {
+    return m_live == other.m_live;
+  }
+
+  bool operator!=(const swappingAllocator &other) const noexcept {
+    return m_live != other.m_live;
+  }
+};
+
+// A block allocated during a swap is freed by the allocator it came from
+static void testSwapAllocators() {
+  int aLive = 0;
+  int bLive = 0;
+  {
+    mpc::smallVector<int, 4, swappingAllocator<int>> a(&aLive);
+    mpc::smallVector<int, 2, swappingAllocator<int>> b(&bLive);
+    for (int i = 0; i < 3; i++) a.push_back(i);
+    b.push_back(7);
+    // a's elements do not fit in b's buffer and move to a new block
+    mpc::swap<int>(a, b);
+    assert(aLive == 1 && bLive == 0 && b.size() == 3 && a[0] == 7);
+    mpc::smallVector<int, 4, swappingAllocator<int>> c(&bLive);
+    for (int i = 3; i < 6; i++) c.push_back(i);
+    // Mixed: c's inline elements do not fit in b's buffer
+    mpc::swap<int>(b, c);
+    assert(aLive == 1 && bLive == 1 && b[0] == 3 && c[2] == 2);
+  }
+  assert(aLive == 0 && bLive == 0);
+}
+
+static void testGrowth() {
+  mpc::smallVector<int, 4, std::allocator<int>, mpc::growHalf> half;
+  for (int i = 0; i < 7; i++) half.push_back(i);
+  assert(half.capacity() == 9);
+
+  mpc::smallVector<int, 4, std::allocator<int>, mpc::growChunk<16>> chunk;
+  for (int i = 0; i < 17; i++) chunk.push_back(i);
+  assert(chunk.capacity() == 32);
+
+  // 6 * 4 bytes land in the 32 byte class
+  mpc::smallVector<int, 4, std::allocator<int>, mpc::growSizeClass> cls;
+  for (int i = 0; i < 5; i++) cls.push_back(i);
+  assert(cls.capacity() == 8);
+
+  mpc::smallVector<int, 4, mpc::mallocAllocator<int>> slack;
+  for (int i = 0; i < 5; i++) slack.push_back(i);
+  assert(slack.capacity() >= 8);
+
+  // Heap growth and shrinking go through realloc
+  for (int i = 5; i < 100000; i++) slack.push_back(i);
+  slack.resize(10);
+  slack.shrink_to_fit();
+  assert(slack.size() == 10 && slack[9] == 9 && slack.capacity() >= 10);
+
+  mpc::smallVector<std::string, 2> s{"a", "b", "c"};
+  s.reserve(10);
+  s.shrink_to_fit();
+  assert(s.capacity() == 3 && s[2] == "c");
+  s.resize(2);
+  s.shrink_to_fit();
+  assert(s.getAlloc() == 0 && s.capacity() == 2 && s[1] == "b");
+}
+
+static void testBulk() {
+  const int src[] = {1, 2, 3, 4, 5, 6};
+  mpc::smallVector<int, 4> a(src, src + 3);
+  a.append(src + 3, src + 6);
+  a.insert(a.begin() + 1, {7, 8});
+  assert(a.size() == 8 && a[1] == 7 && a[2] == 8 && a[3] == 2 && a[7] == 6);
+
+  int *raw = a.append_uninitialized(2);
+  raw[0] = 9;
+  raw[1] = 10;
+  assert(a.size() == 10 && a[9] == 10);
+
+  mpc::smallVector<std::string, 2> s;
+  s.assign(3, "x");
+  const std::string more[] = {"y", "z"};
+  s.insert(s.begin(), more, more + 2);
+  assert(s.size() == 5 && s[0] == "y" && s[1] == "z" && s[2] == "x");
+
+  mpc::smallVector<int, 2> r;
+  r.resize(3);
+  assert(r[2] == 0);
+  r.resize_for_overwrite(5);
+  assert(r.size() == 5);
+
+  // The fill value may be an element that the growth moves away
+  mpc::smallVector<std::string, 2> f{std::string(30, 'f')};
+  f.append(3, f[0]);
+  f.resize(9, f[1]);
+  assert(f.size() == 9 && f[3] == f[0] && f[8] == std::string(30, 'f'));
+}
+
+template <typename V>
+static void checkErase(V &v) {
+  for (int i = 0; i < 10; i++) v.emplace_back(std::to_string(i));
+  v.erase(v.begin() + 2, v.begin() + 4);
+  v.erase(v.begin());
+  v.insert(v.begin(), std::string("a"));
+  v.emplace(v.begin() + 1, 2, 'b');
+  v.insert(v.end() - 1, 2, v[0]);
+  v.pop_back();
+  // a bb 1 4 5 6 7 8 a a
+  assert(v.size() == 10 && v[0] == "a" && v[1] == "bb" && v[3] == "4");
+  assert(v[8] == "a" && v[9] == "a");
+  v.unordered_erase(v.begin());
+  assert(v.front() == "a" && v.size() == 9 && v.back() == "a");
+  assert(mpc::erase_if(v, [](const std::string &e) { return e == "a"; }) ==
+         2);
+  assert(v.size() == 7 && v.front() == "bb" && v.back() == "8");
+}
+
+static void testErase() {
+  mpc::smallVector<std::string, 4> v;
+  checkErase(v);
+  mpc::smallVector<int, 4> ints{1, 2, 3, 4, 5};
+  ints.insert(ints.begin() + 2, 9);
+  ints.erase(ints.begin());
+  assert(ints.size() == 5 && ints[1] == 9 && ints[4] == 5);
+}
+
+static void testErrors() {
+  mpc::smallVector<char, 4> v;
+  assert(!v.try_reserve(size_t(UINT32_MAX) + 1));
+  for (int i = 0; i < 5; i++) assert(v.try_push_back('a'));
+  bool threw = false;
+  try {
+    v.reserve(size_t(UINT32_MAX) + 1);
+  } catch (std::length_error &) {
+    threw = true;
+  }
+  assert(threw && v.size() == 5);
+}
+
+// Not a template, takes vectors of any inline capacity
+static size_t fillBase(mpc::smallVectorBase<std::string> &v, int n) {
+  for (int i = 0; i < n; i++) v.push_back(std::to_string(i));
+  return v.size();
+}
+
+static void testBase() {
+  mpc::smallVector<std::string, 2> a;
+  mpc::smallVector<std::string, 8> b;
+  assert(fillBase(a, 5) == 5 && fillBase(b, 3) == 3);
+  assert(a.getAlloc() == 8 && b.getAlloc() == 0 && a.inlineCapacity() == 2);
+
+  mpc::smallVectorBase<std::string> &ref = a;
+  ref.swap(b);
+  assert(a.size() == 3 && b.size() == 5 && a[2] == "2" && b[4] == "4");
+  a = std::move(b);
+  assert(a.size() == 5 && b.empty() && b.capacity() == 8);
+  mpc::smallVector<std::string, 4> c(a);
+  a.resize(1);
+  a.shrink_to_fit();
+  assert(a.getAlloc() == 0 && a.capacity() == 2 && c[4] == "4");
+
+  mpc::smallVector<int, 2> x{1, 2};
+  mpc::smallVector<int, 4> y{3, 4, 5};
+  mpc::swap<int>(x, y);
+  assert(x.size() == 3 && x.getAlloc() && y.size() == 2 && !y.getAlloc());
+}
+
+static int sum(mpc::span<const int> s) {
+  int res = 0;
+  for (int e : s) res += e;
+  return res;
+}
+
+static void testSpan() {
+  mpc::smallVector<int, 2> a{1, 2, 3, 4};
+  mpc::smallVector<int, 16> b{5, 6};
+  std::vector<int> c{7, 8, 9};
+  int d[] = {10, 11};
+  assert(sum(a) == 10 && sum(b) == 11 && sum(c) == 24 && sum(d) == 21);
+
+  mpc::span<int> s(a);
+  s.subspan(1, 2)[0] = 20;
+  assert(a[1] == 20 && s.last(1).front() == 4 && s.first(3).back() == 3);
+  assert(s.subspan(2).size() == 2 && s.subspan(4).empty());
+  std::vector<int> copy = mpc::makeSpan(a).toVector();
+  mpc::smallVector<int, 2> back(copy.begin(), copy.end());
+  assert(copy.size() == 4 && back[1] == 20);
+}
+
+static void testRelease() {
+  mpc::smallVector<int, 4> a{1, 2, 3};
+  mpc::releasedBuffer<int> buf = a.release();
+  assert(a.empty() && a.capacity() == 4 && buf.size == 3 && buf.capacity == 3);
+  mpc::smallVector<int, 2> b(buf);
+  assert(b.size() == 3 && b.data() == buf.data && b[2] == 3);
+
+  // malloc'd blocks can go straight to C code
+  typedef mpc::mallocAllocator<std::string> mallocStr;
+  mpc::smallVector<std::string, 1, mallocStr> s{"x", "y"};
+  mpc::releasedBuffer<std::string> sbuf = s.release();
+  assert(s.empty() && !s.getAlloc() && sbuf.data[1] == "y");
+  s.adopt(sbuf);
+  assert(s.size() == 2 && s.data() == sbuf.data);
+  sbuf = s.release();
+  for (size_t i = 0; i < sbuf.size; i++) sbuf.data[i].~basic_string();
+  std::free(sbuf.data);
+}
+
+// Counts live instances, the move constructor throws on request
+struct throwingMove {
+  static int live;
+  static int movesLeft;
+  throwingMove() { live++; }
+  throwingMove(const throwingMove &) { live++; }
+  throwingMove(throwingMove &&) {
+    if (movesLeft-- == 0) throw std::runtime_error("move");
+    live++;
+  }
+  ~throwingMove() { live--; }
+};
+
+int throwingMove::live = 0;
+int throwingMove::movesLeft = 0;
+
+static void testStatic() {
+  typedef mpc::staticVector<int, 4> ints;
+  static_assert(std::is_trivially_copyable<ints>::value, "memcpy copies");
+  static_assert(sizeof(ints) == sizeof(int) * 5, "one byte size counter");
+  ints a{1, 2, 3};
+  assert(a.try_push_back(4) && !a.try_push_back(5) && a.full());
+  ints b = a;
+  b.erase(b.begin() + 1);
+  b.insert(b.begin(), 9);
+  assert(b.size() == 4 && b[0] == 9 && b[2] == 3 && a[1] == 2);
+
+  mpc::staticVector<std::string, 2> s;
+  s.push_back("a");
+  s.emplace(s.begin(), "b");
+  bool threw = false;
+  try {
+    s.push_back("c");
+  } catch (std::length_error &) {
+    threw = true;
+  }
+  mpc::staticVector<std::string, 2> t(s);
+  t.unordered_erase(t.begin());
+  t.swap(s);
+  assert(threw && s.size() == 1 && s[0] == "a" && t[0] == "b");
+
+  // Same bulk API as smallVector
+  mpc::staticVector<std::string, 8> bulk(2, "x");
+  const std::string more[] = {"y", "z"};
+  bulk.insert(bulk.begin() + 1, more, more + 2);
+  bulk.append({"w"});
+  bulk.insert(bulk.begin(), 2, bulk[4]);
+  // w w x y z x w
+  assert(bulk.size() == 7 && bulk[0] == "w" && bulk[3] == "y");
+  assert(bulk[5] == "x" && bulk[6] == "w");
+  std::istringstream words("p q");
+  bulk.assign(std::istream_iterator<std::string>(words),
+              std::istream_iterator<std::string>());
+  assert(bulk.size() == 2 && bulk[1] == "q" && bulk.try_reserve(8));
+
+  // Trivially relocatable elements shift with memmove
+  mpc::staticVector<relocBox, 6> boxes;
+  for (int i = 0; i < 5; i++) boxes.emplace_back(i);
+  boxes.emplace(boxes.begin(), 9);
+  boxes.erase(boxes.begin() + 1, boxes.begin() + 3);
+  boxes.unordered_erase(boxes.begin());
+  assert(boxes.size() == 3 && *boxes[0].p == 4 && *boxes[2].p == 3);
+  threw = false;
+  try {
+    a.insert(a.begin(), {5, 6});
+  } catch (std::length_error &) {
+    threw = true;
+  }
+  assert(threw && a.size() == 4 && a[0] == 1);
+
+  // A move that throws halfway leaves no element behind
+  {
+    mpc::staticVector<throwingMove, 4> src(3);
+    throwingMove::movesLeft = 2;
+    threw = false;
+    try {
+      mpc::staticVector<throwingMove, 4> dst(std::move(src));
+    } catch (std::runtime_error &) {
+      threw = true;
+    }
+    assert(threw && throwingMove::live == 3);
+  }
+  assert(throwingMove::live == 0);
+}
+
+// Every size around the vector widths, against the std algorithms
+template <typename T, size_t N>
+static void checkSimd() {
+  for (size_t n = 1; n < 40; n++) {
+    mpc::smallVector<T, N> v;
+    for (size_t i = 0; i < n; i++) v.push_back(T((i * 7) % 11));
+    const T *p = v.data();
+    assert(mpc::simd::sum(v) == std::accumulate(p, p + n, T()));
+    assert(mpc::simd::min(v) == *std::min_element(p, p + n));
+    assert(mpc::simd::max(p, n) == *std::max_element(p, p + n));
+    assert(mpc::simd::count(v, T(3)) == size_t(std::count(p, p + n, T(3))));
+    assert(mpc::simd::find(p, n, T(9)) == std::find(p, p + n, T(9)));
+    mpc::smallVector<T, N> w(v);
+    mpc::simd::add(w, p);
+    mpc::simd::mul(w.data(), p, n);
+    assert(w.back() == T(2) * v.back() * v.back());
+    mpc::simd::fill(w, T(5));
+    assert(std::count(w.begin(), w.end(), T(5)) == std::ptrdiff_t(n));
+  }
+}
+
+static void testSimd() {
+  checkSimd<float, 16>();
+  checkSimd<double, 16>();
+  checkSimd<int32_t, 16>();
+  checkSimd<uint32_t, 16>();
+  checkSimd<int16_t, 16>();
+  // Unrolled inline loops
+  checkSimd<float, 4>();
+  checkSimd<uint32_t, 8>();
+}
+
+static bool alignedTo(const void *p, size_t align) {
+  return reinterpret_cast<uintptr_t>(p) % align == 0;
+}
+
+static void testAlignment() {
+  mpc::alignedSmallVector<float, 3, 32> a;
+  a.push_back(1);
+  assert(alignedTo(a.data(), 32) && alignof(decltype(a)) == 32);
+  for (int i = 0; i < 10; i++) a.push_back(float(i));
+  assert(a.getAlloc() && alignedTo(a.data(), 32) && a[10] == 9);
+  a.resize(2);
+  a.shrink_to_fit();
+  assert(!a.getAlloc() && alignedTo(a.data(), 32));
+
+  typedef mpc::paddedSmallVector<int, 4> padded;
+  static_assert(sizeof(padded) == mpc::cacheLineSize, "one line each");
+  padded rows[2];
+  rows[1].push_back(7);
+  padded copy(rows[1]);
+  padded list{1, 2, 3};
+  assert(alignedTo(&rows[1], mpc::cacheLineSize) && copy[0] == 7);
+  assert(list.size() == 3);
+}
+
+static void testSoa() {
+  typedef mpc::smallSoaVector<std::tuple<float, std::string, char>, 2> soa;
+  soa v;
+  for (int i = 0; i < 6; i++) v.emplace_back(float(i), std::to_string(i), 'a');
+  v.push_back(std::make_tuple(6.f, std::string("6"), 'b'));
+  assert(v.size() == 7 && v.getAlloc() && std::get<1>(v[6]) == "6");
+
+  // Columns are dense arrays
+  float total = 0;
+  for (float f : v.column<0>()) total += f;
+  assert(total == 21 && v.data<2>()[6] == 'b');
+
+  // Fields of an existing row survive the growth they trigger
+  v.emplace_back(v.data<0>()[0], v.data<1>()[1], v.data<2>()[6]);
+  assert(v.size() == 8 && v.capacity() == 8);
+  v.emplace_back(v.data<0>()[3], v.data<1>()[7], v.data<2>()[7]);
+  assert(v.capacity() == 16 && std::get<1>(v[8]) == "1");
+  // getAlloc counts rows like smallVector's, heapBytes the whole block
+  assert(v.getAlloc() == 16 &&
+         v.heapBytes() >= 16 * (sizeof(float) + sizeof(std::string) + 1));
+  v.pop_back();
+  v.pop_back();
+
+  std::get<0>(v.front()) = 10;
+  v.unordered_erase(1);
+  soa copy(v);
+  soa moved(std::move(v));
+  assert(v.empty() && moved.size() == 6 && std::get<1>(moved[1]) == "6");
+  assert(!v.getAlloc() && !v.heapBytes() && moved.getAlloc() == 16);
+  assert(std::get<0>(copy[0]) == 10);
+  size_t bs = 0;
+  for (soa::reference r : copy) bs += std::get<2>(r) == 'b';
+  assert(bs == 1);
+
+  // The heap block is aligned for every column, whatever the arena hands out
+  alignas(double) char buff[512];
+  mpc::arenaResource arena(buff, sizeof(buff));
+  mpc::arenaAllocator<char>(&arena).allocate(1);
+  mpc::smallSoaVector<std::tuple<char, double>, 1, mpc::arenaAllocator<char>>
+      packed(&arena);
+  for (int i = 0; i < 3; i++) packed.emplace_back('x', i);
+  uintptr_t col = reinterpret_cast<uintptr_t>(packed.data<1>());
+  assert(packed.getAlloc() && col % alignof(double) == 0);
+
+  // Arena allocators do not propagate, a move to another arena moves rows
+  typedef mpc::smallSoaVector<std::tuple<int>, 1, mpc::arenaAllocator<char>>
+      arenaSoa;
+  alignas(double) char otherBuff[512];
+  mpc::arenaResource otherArena(otherBuff, sizeof(otherBuff));
+  arenaSoa target(&otherArena);
+  arenaSoa source(&arena);
+  for (int i = 0; i < 4; i++) source.emplace_back(i);
+  mpc::smallSoaVector<std::tuple<int>, 2, std::allocator<char>,
+                      mpc::growChunk<16>>
+      chunked;
+  for (int i = 0; i < 3; i++) chunked.emplace_back(i);
+  assert(chunked.capacity() == 16);
+  target = std::move(source);
+  const char *first = reinterpret_cast<const char *>(target.data<0>());
+  assert(first >= otherBuff && first < otherBuff + sizeof(otherBuff));
+  assert(target.size() == 4 && std::get<0>(target[3]) == 3 && source.empty());
+
+  // A copy gets the default resource
+  mpc::arenaResource pool;
+  mpc::smallSoaVector<std::tuple<int>, 1, mpc::polymorphicAllocator<char>>
+      pmrSoa(&pool);
+  pmrSoa.emplace_back(1);
+  pmrSoa.emplace_back(2);
+  assert(decltype(pmrSoa)(pmrSoa).get_allocator().resource() ==
+         mpc::newDeleteResource());
+}
+
+static void testConcurrent() {
+  mpc::concurrentSmallVector<std::string, 4> cv;
+  std::vector<std::thread> producers;
+  for (int t = 0; t < 4; t++)
+    producers.emplace_back([&cv, t] {
+      for (int i = 0; i < 500; i++) cv.push_back(std::to_string(t * 500 + i));
+    });
+  for (std::thread &th : producers) th.join();
+  assert(cv.size() == 2000);
+  const std::string *first = &cv[3];
+  cv.emplace_back(3, 'x');
+  assert(&cv[3] == first && cv[2000] == "xxx");
+
+  mpc::smallVector<std::string, 4> vec = cv.freeze();
+  assert(cv.empty() && vec.size() == 2001);
+  std::vector<int> seen;
+  for (size_t i = 0; i < 2000; i++) seen.push_back(std::stoi(vec[i]));
+  std::sort(seen.begin(), seen.end());
+  for (int i = 0; i < 2000; i++) assert(seen[i] == i);
+
+  // Small results stay inline
+  mpc::concurrentSmallVector<int, 0> empty;
+  empty.reserve(5);
+  mpc::concurrentSmallVector<int, 8> few;
+  for (int i = 0; i < 3; i++) few.push_back(i);
+  assert(!few.freeze().getAlloc() && empty.freeze().empty());
+
+  // reserve reports its errors instead of aborting
+  bool caught = false;
+  try {
+    few.reserve(SIZE_MAX);
+  } catch (std::length_error &) {
+    caught = true;
+  }
+  assert(caught && few.empty());
+}
+
+static void testBlockCache() {
+  mpc::trimBlockCache();
+  const int *block;
+  {
+    mpc::cachedSmallVector<int, 4> v;
+    for (int i = 0; i < 5; i++) v.push_back(i);
+    // 8 ints rounded up to a 32 byte block
+    assert(v.getAlloc() && v.capacity() == 8);
+    block = v.data();
+  }
+  assert(mpc::blockCacheBytes() == 32);
+  mpc::cachedSmallVector<int, 4> v(7);
+  assert(v.data() == block && mpc::blockCacheBytes() == 0);
+  v.clear();
+  v.shrink_to_fit();
+  assert(mpc::blockCacheBytes() == 32);
+
+  mpc::setBlockCacheLimit(16);
+  assert(mpc::blockCacheBytes() == 0);
+  { mpc::cachedSmallVector<std::string, 1> s(3); }
+  assert(mpc::blockCacheBytes() == 0);
+  mpc::setBlockCacheLimit(1 << 20);
+  { mpc::cachedSmallVector<std::string, 1> s(3); }
+  assert(mpc::blockCacheBytes() == 128);
+  mpc::trimBlockCache();
+  assert(mpc::blockCacheBytes() == 0);
+
+  // late is constructed before the thread's cache and destroyed after it,
+  // its block goes straight back to free (LeakSanitizer checks)
+  std::thread([] {
+    static thread_local mpc::cachedSmallVector<int, 4> late;
+    late.resize(100);
+  }).join();
+}
+
+static void testCompact() {
+  static_assert(sizeof(mpc::compactVector<int, 0>) == sizeof(void *),
+                "empty compactVector is one word");
+  static_assert(sizeof(mpc::compactVector<char, 8>) == 2 * sizeof(void *),
+                "8 chars plus the tag");
+  mpc::compactVector<std::string, 2> v{"a", "b"};
+  assert(!v.getAlloc() && v.capacity() == 2);
+  v.push_back("c");
+  v.insert(v.begin(), "z");
+  v.emplace(v.begin() + 2, 2, 'y');
+  assert(v.getAlloc() && v.size() == 5 && v[0] == "z" && v[2] == "yy");
+  v.erase(v.begin(), v.begin() + 2);
+  v.unordered_erase(v.begin());
+  assert(v.size() == 2 && v[0] == "c" && v[1] == "b");
+
+  mpc::compactVector<std::string, 2> copy(v);
+  mpc::compactVector<std::string, 2> moved(std::move(v));
+  assert(v.empty() && moved.getAlloc() &&
+         std::equal(copy.begin(), copy.end(), moved.begin()));
+  moved.shrink_to_fit();
+  assert(!moved.getAlloc() && moved[1] == "b");
+  copy.append(3, "x");
+  swap(copy, moved);
+  assert(copy.size() == 2 && moved.size() == 5 && moved.back() == "x");
+  assert(mpc::erase_if(moved, [](const std::string &s) {
+           return s == "x";
+         }) == 3);
+
+  mpc::compactVector<int, 0> w;
+  assert(w.empty() && w.data() == nullptr);
+  for (int i = 0; i < 9; i++) w.push_back(i);
+  w.resize(12, 7);
+  assert(w.size() == 12 && w.capacity() >= 12 && w[8] == 8 && w[11] == 7);
+  assert(w.try_push_back(5) && w.size() == 13);
+  w = {1, 2};
+  mpc::compactVector<int, 0> z;
+  z = std::move(w);
+  assert(z.size() == 2 && w.empty());
+
+  // The fill value may be an element that the growth moves away
+  const std::string longStr(30, 'f');
+  mpc::compactVector<std::string, 2> f{longStr, longStr};
+  f.append(3, f[0]);
+  f.resize(9, f[1]);
+  assert(f.size() == 9 && f[4] == longStr && f[8] == longStr);
+}
+
+static void testSerialize() {
+  std::stringstream ss;
+  mpc::smallVector<uint64_t, 4> a = {1, 2, 3, 4, 5};
+  mpc::smallVector<uint64_t, 8> b;
+  assert(mpc::writeVector(ss, a) && mpc::readVector(ss, b));
+  assert(b.size() == 5 && std::equal(a.begin(), a.end(), b.begin()));
+  assert(!mpc::readVector(ss, b) && b.empty());
+
+  // Tiny batches force both the gathered and the direct writes
+  std::vector<mpc::smallVector<uint64_t, 4>> vecs(3);
+  vecs[0] = a;
+  for (uint64_t i = 0; i < 40; i++) vecs[2].push_back(i);
+  const char *path = "testMain.bin";
+  {
+    std::ofstream os(path, std::ios::binary);
+    assert(mpc::writeVectors(os, vecs.begin(), vecs.end(), 64));
+  }
+  std::ifstream is(path, std::ios::binary);
+  std::vector<mpc::smallVector<uint64_t, 4>> back;
+  assert(mpc::readVectors(is, back) && back.size() == 3);
+  assert(back[1].empty() && back[2].size() == 40 && back[2][39] == 39);
+
+#if MPC_SV_HAS_MMAP
+  mpc::mappedVectors<uint64_t> view(path);
+  assert(view.is_open() && view.size() == 3 && view[0].size() == 5);
+  assert(view[1].empty() && view[2][7] == 7 && view[0][4] == 5);
+  mpc::mappedVectors<uint32_t> wrongType(path);
+  assert(!wrongType.is_open());
+#endif
+  std::remove(path);
+}
+
+static void testVectorArray() {
+  mpc::smallVectorArray<int, 2> rows(3);
+  for (int i = 0; i < 5; i++) rows.push_back(0, i);
+  rows.push_back(1, 7);
+  for (int i = 0; i < 3; i++) rows.push_back(2, 10 + i);
+  assert(rows.size() == 3 && rows.row_size(0) == 5 && rows[1][0] == 7);
+  assert(rows[0][4] == 4 && rows[2][2] == 12 && rows.garbage() == 0);
+
+  // Row 0 is no longer last in the arena, so it moves and leaves garbage
+  for (int i = 5; i < 9; i++) rows.push_back(0, i);
+  assert(rows.garbage() == 8 && rows[0][8] == 8 && rows.arena_size() == 28);
+  rows.pop_back(2);
+  rows.pop_back(2);
+  size_t r = rows.add_row();
+  rows.push_back(r, rows[1][0]);
+
+  rows.compact();
+  assert(rows.garbage() == 0 && rows.arena_size() == 9);
+  assert(rows[2].size() == 1 && rows[2][0] == 10 && rows[3][0] == 7);
+  int total = 0;
+  for (int x : rows[0]) total += x;
+  assert(total == 36);
+
+  mpc::smallVectorArray<int, 0> none(1);
+  none.push_back(0, 1);
+  none.push_back(0, 2);
+  assert(none[0].size() == 2 && none[0][1] == 2);
+}
+
+static void testParallel() {
+  mpc::parallel::threadPool pool(3);
+  mpc::smallVector<int, 8> v;
+  for (int i = 0; i < 100000; i++) v.push_back((i * 7919) % 100003);
+  long long total = std::accumulate(v.begin(), v.end(), 0LL);
+  mpc::parallel::sort(v, std::less<int>(), pool);
+  assert(std::is_sorted(v.begin(), v.end()));
+  assert(mpc::parallel::reduce(v, 0LL, std::plus<long long>(), pool) == total);
+
+  mpc::parallel::for_each(v, [](int &x) { x += 1; }, pool);
+  mpc::smallVector<long long, 0> twice;
+  mpc::parallel::transform(v, twice, [](int x) { return 2LL * x; }, pool);
+  assert(twice.size() == v.size() && twice[5] == 2LL * v[5]);
+  assert(std::accumulate(twice.begin(), twice.end(), 0LL) ==
+         2 * (total + 100000));
+
+  // Inline vectors stay on the calling thread
+  mpc::smallVector<int, 8> small = {3, 1, 2};
+  mpc::parallel::sort(small);
+  assert(small[0] == 1 && mpc::parallel::reduce(small) == 6);
+
+  bool caught = false;
+  auto thrower = [](int x) {
+    if (x == 777) throw std::runtime_error("777");
+  };
+  try {
+    mpc::parallel::for_each(v, thrower, pool);
+  } catch (std::runtime_error &) {
+    caught = true;
+  }
+  assert(caught);
+}
+
+// Transparent comparator, std::less<> is C++14
+struct lessString {
+  typedef void is_transparent;
+  bool operator()(const std::string &a, const std::string &b) const {
+    return a < b;
+  }
+  bool operator()(const std::string &a, const char *b) const { return a < b; }
+  bool operator()(const char *a, const std::string &b) const { return a < b; }
+};
+
+// std::hash that counts its calls
+struct countingHash {
+  static size_t calls;
+  size_t operator()(int key) const {
+    calls++;
+    return std::hash<int>()(key);
+  }
+};
+
+size_t countingHash::calls = 0;
+
+static void testFlat() {
+  // Bulk construction sorts once and keeps the first of equal keys
+  mpc::smallFlatSet<int, 4> set = {5, 1, 5, 3};
+  assert(set.size() == 3 && *set.begin() == 1 && !set.sequence().getAlloc());
+  assert(set.insert(4).second && !set.insert(3).second);
+  set.insert({9, 0, 9});
+  assert(set.size() == 6 && set.sequence().getAlloc() && set.contains(9));
+  assert(*set.lower_bound(2) == 3 && *set.upper_bound(4) == 5);
+  assert(set.erase(4) == 1 && set.count(4) == 0);
+  assert(mpc::erase_if(set, [](int x) { return x % 3 == 0; }) == 3);
+  assert(set.size() == 2 && set.find(5) != set.end());
+
+  // The inline insertion sort keeps the first of equal keys like the heap
+  // path's stable_sort, also when merging into existing values
+  typedef mpc::smallFlatMap<int, char, 8> charMap;
+  charMap small = {{3, 'a'}, {1, 'b'}, {3, 'c'}, {2, 'd'}, {1, 'e'}};
+  assert(!small.sequence().getAlloc() && small.size() == 3);
+  small.insert({{0, 'f'}, {2, 'g'}, {4, 'h'}, {0, 'i'}});
+  assert(!small.sequence().getAlloc() && small.size() == 5);
+  std::string firsts;
+  for (const auto &kv : small) firsts += kv.second;
+  assert(firsts == "fbdah" && small.begin()->first == 0);
+  charMap spilled = {{3, 'a'}, {1, 'b'}, {3, 'c'}, {2, 'd'}, {1, 'e'},
+                     {9, 'j'}, {8, 'k'}, {7, 'l'}, {9, 'm'}, {6, 'n'}};
+  assert(spilled.sequence().getAlloc() && spilled.size() == 7);
+  assert(spilled.at(3) == 'a' && spilled.at(1) == 'b' && spilled.at(9) == 'j');
+
+  // Heterogeneous lookup through a transparent comparator
+  mpc::smallFlatMap<std::string, int, 4, lessString> map;
+  map["b"] = 2;
+  map.emplace("a", 1);
+  assert(map.try_emplace("a", 7).second == false && map.at("a") == 1);
+  map.insert_or_assign("c", 3);
+  assert(map.find("c")->second == 3 && map.begin()->first == "a");
+  bool caught = false;
+  try {
+    map.at("z");
+  } catch (std::out_of_range &) {
+    caught = true;
+  }
+  assert(caught);
+
+  // Past 8 entries lookups go through the hash index
+  mpc::smallFlatMap<int, int, 4, std::less<int>, 8> hashed;
+  for (int i = 0; i < 20; i++) hashed[(i * 7) % 20] = i;
+  assert(hashed.size() == 20 && hashed.at(14) == 2);
+  assert(hashed.find(21) == hashed.end());
+  hashed.erase(14);
+  assert(hashed.find(14) == hashed.end() && hashed.at(13) == 19);
+
+  // operator[] keeps a built index up to date instead of rehashing it
+  mpc::smallFlatMap<int, int, 4, std::less<int>, 8, countingHash> counted;
+  countingHash::calls = 0;
+  for (int i = 0; i < 1000; i++) {
+    counted[(i * 7919) % 1000] = i;
+    assert(counted.find((i / 2 * 7919) % 1000)->second == i / 2);
+  }
+  assert(countingHash::calls < 20000);
+  for (int i = 0; i < 1000; i++) assert(counted.at((i * 7919) % 1000) == i);
+}
+
+static void testDeque() {
+  // FIFO use wraps the inline ring without allocating
+  mpc::smallDeque<int, 4> fifo;
+  for (int i = 0; i < 20; i++) {
+    fifo.push_back(i);
+    if (fifo.size() == 3) fifo.pop_front();
+  }
+  assert(fifo.size() == 2 && fifo.front() == 18 && fifo.back() == 19);
+  assert(!fifo.getAlloc());
+
+  // Growth while wrapped keeps the order
+  mpc::smallDeque<std::string, 4> deq;
+  deq.push_back("c");
+  deq.push_front("b");
+  deq.push_front("a");
+  deq.emplace_back("d");
+  deq.push_front("0");
+  assert(deq.getAlloc() == 8 && deq.size() == 5);
+  std::string seq;
+  for (const std::string &str : deq) seq += str;
+  assert(seq == "0abcd");
+
+  // Wrap on the heap, then rotate into place
+  deq.pop_back();
+  deq.push_front(std::string(40, 'x'));
+  deq.push_front("y");
+  mpc::span<std::string> flat = deq.as_contiguous();
+  assert(flat.size() == 6 && flat[0] == "y" && flat[1].size() == 40);
+  assert(flat[2] == "0" && flat[5] == "c" && &flat[0] == &deq.front());
+
+  // Copies, moves and swaps across inline and heap
+  mpc::smallDeque<std::string, 4> small = {"p", "q"};
+  small.push_front("o");
+  mpc::smallDeque<std::string, 4> copy(deq);
+  assert(std::equal(copy.begin(), copy.end(), deq.begin()));
+  copy.swap(small);
+  assert(copy.size() == 3 && copy[0] == "o" && small.size() == 6);
+  mpc::smallDeque<std::string, 4> moved(std::move(small));
+  assert(moved.size() == 6 && small.empty() && moved.back() == "c");
+  small = copy;
+  assert(small.size() == 3 && small.back() == "q");
+  std::sort(moved.begin(), moved.end());
+  assert(moved.front() == "0" && moved.back() == "y");
+}
+
+static void testBytes() {
+  typedef mpc::smallVectorBytes<int> line;
+  typedef mpc::smallVectorTraits<line> lineTraits;
+  static_assert(sizeof(line) <= mpc::cacheLineSize &&
+                    sizeof(mpc::smallVector<int, lineTraits::inlineCapacity +
+                                                          1>) >
+                        mpc::cacheLineSize,
+                "largest N on one line");
+  static_assert(lineTraits::overhead == svHeader, "header only");
+  static_assert(lineTraits::cacheLines == 1 && lineTraits::trivialRelocate &&
+                    lineTraits::trivialCopy && !lineTraits::inPlaceGrowth,
+                "int takes the memcpy paths");
+
+  // Padding after a 3 byte element is counted
+  struct rgb {
+    unsigned char c[3];
+  };
+  typedef mpc::smallVectorBytes<rgb, 2 * mpc::cacheLineSize> rgbs;
+  static_assert(mpc::smallVectorTraits<rgbs>::cacheLines == 2 &&
+                    mpc::bytesCapacity<rgb, 128>::value == (128 - svHeader) / 3,
+                "(128 - header) / 3 elements");
+  typedef mpc::smallVectorTraits<mpc::smallVectorBytes<std::string, 128>>
+      strTraits;
+  static_assert(!strTraits::trivialCopy && !strTraits::trivialDestroy &&
+                    strTraits::objectSize <= 128,
+                "strings fit too");
+
+  line vec = {1, 2, 3};
+  assert(vec.inlineCapacity() == lineTraits::inlineCapacity);
+}
+
+static void testShared() {
+  // Inline copies are by value
+  mpc::sharedSmallVector<std::string, 2> small = {"a"};
+  mpc::sharedSmallVector<std::string, 2> smallCopy(small);
+  assert(small.use_count() == 0 && &small[0] != &smallCopy[0]);
+
+  // Heap copies share the block until the first mutation
+  mpc::sharedSmallVector<std::string, 2> vec;
+  for (int i = 0; i < 6; i++) vec.push_back(std::to_string(i));
+  mpc::sharedSmallVector<std::string, 2> copy(vec);
+  mpc::sharedSmallVector<std::string, 2> third;
+  third = copy;
+  assert(vec.use_count() == 3 && copy.cbegin() == vec.cbegin());
+  const mpc::sharedSmallVector<std::string, 2> &view = copy;
+  assert(view[5] == "5" && view.use_count() == 3);
+
+  copy.push_back("6");
+  assert(copy.use_count() == 1 && vec.use_count() == 2);
+  assert(copy.size() == 7 && vec.size() == 6 && copy[3] == "3");
+  third[0] = "x";
+  assert(vec.use_count() == 1 && vec[0] == "0" && third[0] == "x");
+
+  // Clearing a shared block only drops the reference
+  mpc::sharedSmallVector<std::string, 2> fourth(vec);
+  fourth.clear();
+  assert(fourth.empty() && !fourth.getAlloc() && vec.use_count() == 1);
+  fourth = std::move(vec);
+  assert(fourth.size() == 6 && vec.empty() && fourth.use_count() == 1);
+  fourth.resize(1);
+  fourth.swap(small);
+  assert(fourth.size() == 1 && fourth[0] == "a" && small[0] == "0");
+}
+
+static void testString() {
+  // 31 characters inline, always terminated
+  mpc::smallString<> key("user:");
+  key.append_int(-42).append(":", 1).append_int(18446744073709551615ULL);
+  assert(key == "user:-42:18446744073709551615" && !key.getAlloc());
+  assert(std::strlen(key.c_str()) == key.size() && key.capacity() == 31);
+  key += "/suffix";
+  assert(key.getAlloc() && key.c_str()[key.size()] == '\0');
+  assert(key.ends_with("/suffix") && key.starts_with("user:-"));
+
+  // Appending a part of itself survives the growth
+  mpc::smallString<8> self("abcdef");
+  self.append(self.data() + 2, 4);
+  assert(self == "abcdefcdef" && self.size() == 10);
+  self.pop_back();
+  self.push_back('x');
+  assert(self.str() == "abcdefcdex");
+
+  // memchr / memcmp search and ordering
+  const size_t npos = mpc::smallString<8>::npos;
+  assert(self.find('c') == 2 && self.find('c', 3) == 6);
+  assert(self.find('z') == npos && self.find('x', 10) == npos);
+  assert(self.find("cde") == 2 && self.find("cde", 3) == 6);
+  assert(self.find("dex") == 7 && self.find("dexx") == npos);
+  assert(self.find("cdz", 0, 2) == 2 && self.find("", 10) == 10);
+  assert(self.substr(6) == "cdex" && self.substr(1, 2) == "bc");
+  mpc::smallString<16> other("abcdefcdex");
+  assert(other == self && !(other < self) && self.compare("abd") < 0);
+  assert(mpc::smallString<>("ab") < mpc::smallString<>("abc"));
+  assert(std::hash<mpc::smallString<16>>()(other) == self.hash());
+  assert(mpc::smallString<>("ab").hash() != mpc::smallString<>("ba").hash());
+
+  // Moves leave an empty, terminated string
+  mpc::smallString<8> moved(std::move(self));
+  assert(self.empty() && *self.c_str() == '\0' && moved.size() == 10);
+  moved.erase(2, 4);
+  moved.resize(3);
+  self = "xyz";
+  self.assign(self.data() + 1, 2);
+  assert(moved == "abc" && self == "yz");
+  std::ostringstream os;
+  os << moved << self;
+  assert(os.str() == "abcyz");
+}
+
+// Counters of one instantiation, only recorded by make stats
+static void testStats() {
+#if MPC_SV_STATS
+  struct tag {
+    long v;
+  };
+  typedef mpc::smallVector<tag, 3> vec;
+  mpc::smallVectorStats &s = vec::stats();
+  s.reset();
+  size_t spillCap, growCap;
+  {
+    vec small(2);
+    vec big(3);
+    assert(s.spills() == 0 && s.bytesAllocated() == 0);
+    big.push_back(tag());
+    spillCap = big.capacity();
+    assert(s.spills() == 1 && s.growths() == 0 &&
+           s.bytesAllocated() == spillCap * sizeof(tag));
+    big.resize(spillCap + 1);
+    growCap = big.capacity();
+    assert(s.growths() == 1 &&
+           s.bytesAllocated() == (spillCap + growCap) * sizeof(tag));
+    // The peak survives shrinking, nothing is counted before destruction
+    big.resize(1);
+    assert(s.objects() == 0);
+  }
+  assert(s.objects() == 2 && s.histogram(2) == 1 &&
+         s.histogram(spillCap + 1) == 1 && s.inlineCapacity() == 3);
+  assert(s.percentile(0.5) == 2 && s.percentile(1) == spillCap + 1);
+
+  // Sizes past the exact buckets land in power of two buckets
+  { vec(200); }
+  assert(s.histogram(mpc::smallVectorStats::exactBuckets + 1) == 1 &&
+         s.percentile(1) == 255);
+
+  // The registry holds this instantiation, dump prints a line for it
+  bool found = false;
+  for (mpc::smallVectorStats *it = mpc::smallVectorStats::first(); it;
+       it = it->next())
+    found |= it == &s;
+  assert(found);
+  std::ostringstream os;
+  mpc::smallVectorStats::dump(os);
+  std::ostringstream line;
+  line << s.name() << ": objects=3 spills=2 growths=";
+  assert(s.name().find("smallVector") != std::string::npos &&
+         os.str().find(line.str()) != std::string::npos);
+  s.reset();
+  assert(s.objects() == 0 && s.bytesAllocated() == 0 && s.histogram(2) == 0);
+#endif
+}
 
 int main(int argc, char** argv) {
   std::cout << "Test Main start." << std::endl;
   mpc::smallVector<int> vec(5);
+  testLayout();
+  testTrivialPaths();
+  testAllocators();
+  testSwapAllocators();
+  testGrowth();
+  testBulk();
+  testErase();
+  testErrors();
+  testBase();
+  testSpan();
+  testRelease();
+  testStatic();
+  testSimd();
+  testAlignment();
+  testSoa();
+  testConcurrent();
+  testBlockCache();
+  testCompact();
+  testSerialize();
+  testVectorArray();
+  testParallel();
+  testFlat();
+  testDeque();
+  testBytes();
+  testShared();
+  testString();
+  testStats();
   std::cout << "Test Main end." << std::endl;
   return 0;
 }